@@ -7,4 +7,7 @@ SUBDIRS       = swe \
 		plain \
 		planets \
 		details \
-		zodiac
+		zodiac \
+		events \
+		bench \
+		bench/check
@@ -4,6 +4,9 @@ SOURCES += \
     src/astro-output.cpp \
     src/astro-data.cpp \
     src/astro-calc.cpp \
+    src/astro-ephcache.cpp \
+    src/astro-chartcache.cpp \
+    src/astro-trace.cpp \
     src/csvreader.cpp
 
 HEADERS +=\
@@ -13,10 +16,14 @@ HEADERS +=\
     src/astro-output.h \
     src/astro-data.h \
     src/astro-calc.h \
+    src/astro-ephcache.h \
+    src/astro-chartcache.h \
+    src/astro-trace.h \
     include/Astroprocessor/Output \
     include/Astroprocessor/Gui \
     include/Astroprocessor/Data \
     include/Astroprocessor/Calc \
+    include/Astroprocessor/Trace \
     include/Astroprocessor/Zodiac \
     src/csvreader.h
 
@@ -8,13 +8,24 @@
 #define min min
 
 #include <math.h>
+#include <functional>
+#include <numeric>
 #include <tuple>
+#include <unordered_set>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 #include <boost/math/tools/minima.hpp>
 #include <boost/math/tools/roots.hpp>
 
 #include "astro-calc.h"
 #include "astro-gui.h"
+#include "astro-ephcache.h"
+#include "astro-trace.h"
 
 #include <swephexp.h>
 #include <swehouse.h>
@@ -86,9 +97,9 @@ double getUTfromET(double et)
 }
 
 unsigned
-windowOf(PlanetLoc* pl)
+windowOf(const ChartPlanetId& cpid)
 {
-    switch (pl->planet.planetId()) {
+    switch (cpid.planetId()) {
     case Planet_Mercury: return 45;
     case Planet_Venus: return 90;
     case Planet_Mars: return 210;
@@ -97,6 +108,49 @@ windowOf(PlanetLoc* pl)
     }
 };
 
+// Fastest a body's ecliptic longitude ever moves, degrees per day, or 0
+// if there's no telling (the angles, or another aspect mode). The
+// figures are the largest geocentric speeds the Swiss Ephemeris gives
+// (SEFLG_SWIEPH|SEFLG_SPEED, the files in bin/swe) sampled every half
+// day over 1800-2400, with a quarter again to spare. The Moon and the
+// true node were sampled every .05 day over 1900-2100, and Chiron over
+// 1800-2100, as far as its file goes.
+qreal
+maxSpeedOf(const ChartPlanetId& cpid, aspectModeEnum mode)
+{
+    const qreal headroom = 1.25;
+
+    if (mode != amcEcliptic) return 0;
+    if (cpid.isMidpt()) {
+        auto s1 = maxSpeedOf(ChartPlanetId(cpid.planetId()), mode);
+        auto s2 = maxSpeedOf(ChartPlanetId(cpid.planetId2()), mode);
+        return (s1 && s2)? (s1 + s2) / 2 : 0;
+    }
+    qreal s;
+    switch (cpid.planetId()) {
+    case Planet_Sun: s = 1.0199; break;
+    case Planet_Moon: s = 15.3957; break;
+    case Planet_Mercury: s = 2.2034; break;
+    case Planet_Venus: s = 1.2594; break;
+    case Planet_Mars: s = .7915; break;
+    case Planet_Jupiter: s = .2427; break;
+    case Planet_Saturn: s = .1339; break;
+    case Planet_Uranus: s = .0651; break;
+    case Planet_Neptune: s = .0433; break;
+    case Planet_Pluto: s = .0405; break;
+    case Planet_NorthNode:
+    case Planet_SouthNode: s = .2592; break;
+    case Planet_Chiron: s = .1468; break;
+    case Planet_Ceres: s = .4607; break;
+    case Planet_Pallas: s = .6116; break;
+    case Planet_Juno: s = .5987; break;
+    case Planet_Vesta: s = .5428; break;
+    default:
+        return 0;
+    }
+    return s * headroom;
+}
+
 inline
 qreal
 harmonic(double h, qreal value)
@@ -164,9 +218,9 @@ getHouses(ZodiacSignId sign, const Houses &houses, const Zodiac& zodiac)
 }
 
 float
-angle(const Star& body1, const Star& body2)
+angle(const Star& body1, const Star& body2, aspectModeEnum mode)
 {
-    switch (aspectMode) {
+    switch (mode) {
     case amcGreatCircle:
     {
         float a = angle(body1.eclipticPos.x(), body2.eclipticPos.x());
@@ -227,14 +281,14 @@ angle(float deg1, float deg2)
 
 AspectId
 aspect(const Star& planet1, const Star& planet2,
-       const AspectsSet& aspectSet)
+       const AspectsSet& aspectSet, aspectModeEnum mode)
 {
 #if 0
     if (planet1.isPlanet() && planet2.isPlanet()
         && planet1.getSWENum() == planet2.getSWENum())
         return Aspect_None;
 #endif
-    return aspect(angle(planet1, planet2), aspectSet);
+    return aspect(angle(planet1, planet2, mode), aspectSet);
 }
 
 inline
@@ -372,10 +426,10 @@ bool rulerDisposition(int house, int houseAuthority, const Horoscope& scope)
     return false;
 }
 
-bool isEarlier(const Planet& planet, const Planet& sun)
+bool isEarlier(const Planet& planet, const Planet& sun, aspectModeEnum mode)
 {
  //float opposite = roundDegree(sun.eclipticPos.x() - 180);
-    switch (aspectMode) {
+    switch (mode) {
     case amcPrimeVertical:
         return (roundDegree(planet.pvPos - sun.pvPos) > 180);
     case amcEquatorial:
@@ -414,15 +468,109 @@ PlanetId receptionWith(const Planet& planet, const Horoscope& scope)
     return Planet_None;
 }
 
+EphemerisFrame::EphemerisFrame(const InputData& input, ZodiacId zid) :
+    jd(getJulianDate(input.GMT())),
+    zid(zid)
+{
+    char errStr[256] = "";
+    double xx[6];
+
+    geopos[0] = input.location().x();
+    geopos[1] = input.location().y();
+    geopos[2] = 199 /*meters*/; //input.location.z();
+
+    swe_calc_ut(jd, SE_ECL_NUT, 0, xx, errStr);
+    epsTrue = xx[0];
+    epsMean = xx[1];
+    nutLon = xx[2];
+    nutLonSpeed = 0;
+
+    armc = swe_degnorm(swe_sidtime(jd) * 15 + geopos[0]);
+
+    if (zid > 1) {
+        // speeds by difference over the same interval swe uses
+        constexpr double dt = .001;
+        swe_set_sid_mode(zid - 2, 0, 0);
+        double was;
+        swe_get_ayanamsa_ex_ut(jd - dt, SEFLG_SWIEPH, &was, errStr);
+        swe_get_ayanamsa_ex_ut(jd, SEFLG_SWIEPH, &aya, errStr);
+        ayaSpeed = swe_difdeg2n(aya, was) / dt;
+
+        swe_calc_ut(jd - dt, SE_ECL_NUT, 0, xx, errStr);
+        nutLonSpeed = (nutLon - xx[2]) / dt;
+    }
+
+    sunFlags = SEFLG_SWIEPH | SEFLG_SPEED;
+    if (swe_calc_ut(jd, SE_SUN, sunFlags, sun, errStr) == ERR) {
+        qDebug("A: can't calculate position of the Sun at julian day %f: %s",
+               jd, errStr);
+    }
+}
+
+void
+EphemerisFrame::toEquatorial(const double* ecl, double* equ) const
+{
+    double x[6];
+    std::copy(ecl, ecl + 6, x);
+    double eps = epsTrue;
+    if (zid > 1) {
+        // swe leaves nutation out of sidereal positions, so sidereal
+        // charts have always had their right ascensions off the mean
+        // equator
+        x[0] = swe_degnorm(x[0] - nutLon);
+        x[3] -= nutLonSpeed;
+        eps = epsMean;
+    }
+    swe_cotrans_sp(x, equ, -eps);
+}
+
+void
+EphemerisFrame::toHorizontal(const double* ecl, double* hor) const
+{
+    // swe_azalt(SE_ECL2HOR) less the refraction, which we don't use
+    double x[3] = { ecl[0], ecl[1], 1 };
+    swe_cotrans(x, x, -epsTrue);
+    x[0] = swe_degnorm(swe_degnorm(x[0] - armc) - 90);
+    x[2] = 1;
+    swe_cotrans(x, x, 90 - geopos[1]);  // azimuth from east, counterclockwise
+    hor[0] = 360 - swe_degnorm(x[0] + 90);  // from south, through west
+    hor[1] = x[1];
+}
+
+void
+EphemerisFrame::phase(const double* ecl,
+                      double& phaseAngle,
+                      double& elongation) const
+{
+    auto cart = [](const double* pol, double* c) {
+        double cl = cosd(pol[1]);
+        c[0] = pol[2] * cl * cosd(pol[0]);
+        c[1] = pol[2] * cl * sind(pol[0]);
+        c[2] = pol[2] * sind(pol[1]);
+    };
+    auto angle = [](const double* a, const double* b) {
+        double ab = a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+        double aa = a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+        double bb = b[0]*b[0] + b[1]*b[1] + b[2]*b[2];
+        return acosd(qBound(-1., ab / sqrt(aa * bb), 1.));
+    };
+
+    double p[3], s[3], ps[3], pe[3];
+    cart(ecl, p);
+    cart(sun, s);
+    for (int i = 0; i < 3; ++i) {
+        ps[i] = s[i] - p[i];        // body to sun
+        pe[i] = -p[i];              // body to earth
+    }
+    elongation = angle(p, s);
+    phaseAngle = angle(ps, pe);
+}
+
+namespace {
+
 Planet
 calculatePlanet(PlanetId planet,
-                const InputData& input,
-                double jd,
-                double& eps,
-                unsigned int& flags,
-                double& ablong,
-                double RAMC,
-                ZodiacId zid)
+                const EphemerisFrame& frame)
 {
     Planet ret = getPlanet(planet);
 
@@ -430,103 +578,58 @@ calculatePlanet(PlanetId planet,
     char    errStr[256] = "";
     double  xx[6];
 
-    // turn off true pos
-    flags = (SEFLG_SWIEPH | ret.sweFlags) & ~SEFLG_TRUEPOS;
-
-    if (zid > 1) {
-        flags |= SEFLG_SIDEREAL;
-        swe_set_sid_mode(zid - 2, 0, 0);
-    }
-    swe_calc_ut(jd, SE_ECL_NUT, 0, xx, errStr);
-    eps = xx[0];
+    // turn off true pos. This one evaluation is tropical and in the
+    // true ecliptic of date; the rest is rotations in the frame.
+    int flags = (SEFLG_SWIEPH | SEFLG_SPEED | ret.sweFlags) & ~SEFLG_TRUEPOS;
 
     // TODO: wrong moon speed calculation
     // (flags: SEFLG_TRUEPOS|SEFLG_SPEED = 272)
     //         272|invertPositionFlag = 262416
-    if (swe_calc_ut(jd, ret.sweNum, flags, xx, errStr) == ERR) {
+    if (ret.sweNum == SE_SUN && flags == frame.sunFlags) {
+        std::copy(frame.sun, frame.sun + 6, xx);
+    } else if (swe_calc_ut(frame.jd, ret.sweNum, flags, xx, errStr) == ERR) {
         qDebug("A: can't calculate position of '%s' at julian day %f: %s",
-               qPrintable(ret.name), jd, errStr);
+               qPrintable(ret.name), frame.jd, errStr);
+    }
+
+    double lon = xx[0], lonSpeed = xx[3];
+    if (frame.zid > 1) {
+        lon = swe_degnorm(lon - frame.aya);
+        lonSpeed -= frame.ayaSpeed;
     }
     if (!(ret.sweFlags & invertPositionFlag))
-        ret.eclipticPos.setX(xx[0]);
+        ret.eclipticPos.setX(lon);
     else                               // found 'inverted position' flag
-        ret.eclipticPos.setX(roundDegree(xx[0] - 180));
+        ret.eclipticPos.setX(roundDegree(lon - 180));
 
     ret.eclipticPos.setY(xx[1]);
     ret.distance = xx[2];
-    ret.eclipticSpeed.setX(xx[3]);
+    ret.eclipticSpeed.setX(lonSpeed);
     ret.eclipticSpeed.setY(xx[4]);
 
     if (/*ret.sweNum != SE_MOON &&*/ ret.sweNum != SE_SUN) {
-        double phaen[20];
-        swe_pheno_ut(jd, ret.sweNum, flags, phaen, errStr);
-        ret.phaseAngle = phaen[0];
-        ret.elongation = phaen[2];
-    }
-
-    double geopos[3];
-    geopos[0] = input.location().x();
-    geopos[1] = input.location().y();
-    geopos[2] = 199 /*meters*/; //input.location.z();
-
-    ablong = xx[0];
-
-    // A hack to calculate prime vertical longitude from the campanus house position
-    if (zid <= 1
-        || swe_calc_ut(jd, ret.sweNum, flags & ~SEFLG_SIDEREAL,
-                       xx, errStr) != ERR)
-    {
-        ablong = xx[0];
-        // We may have had to get tropical position to get the
-        // house position -- this API wants tropical longitude.
-        // From there we fudge a prime vertical coordinate.
-        double housePos =
-                swe_house_pos(RAMC, geopos[1], eps,
-                'C', xx, errStr);
-        ret.pvPos = (housePos - 1) / 12 * 360;
+        frame.phase(xx, ret.phaseAngle, ret.elongation);
     }
 
-    // calculate horizontal coordinates
-    double hor[3];
-    swe_azalt(jd, SE_ECL2HOR, geopos, 0, 0, xx, hor);
-    ret.horizontalPos.setX(hor[0]);
-    ret.horizontalPos.setY(hor[1]);
-
-    if (swe_calc_ut(jd, ret.sweNum,
-                    flags | SEFLG_EQUATORIAL | SEFLG_SPEED,
-                    xx, errStr) != ERR) {
-        ret.equatorialPos.setX(xx[0]);
-        ret.equatorialPos.setY(xx[1]);
-        ret.equatorialSpeed.setX(xx[3]);
-        ret.equatorialSpeed.setY(xx[4]);
-    }
+    double equ[6];
+    frame.toEquatorial(xx, equ);
+    ret.equatorialPos.setX(equ[0]);
+    ret.equatorialPos.setY(equ[1]);
+    ret.equatorialSpeed.setX(equ[3]);
+    ret.equatorialSpeed.setY(equ[4]);
 
     return ret;
 }
 
-Planet 
-calculatePlanet(PlanetId planet,
-                const InputData& input,
-                const Houses& houses,
-                const Zodiac& zodiac)
+// Sign, house, position and rulerships: what the zodiac and house
+// system make of the ecliptic position.
+void
+placePlanet(Planet& ret, const Houses& houses, const Zodiac& zodiac)
 {
-    double  jd = getJulianDate(input.GMT());
-
-    char    errStr[256] = "";
-
-    double eps, ablong;
-    unsigned int flags;
-    Planet ret = calculatePlanet(planet, input, jd, eps, flags, ablong,
-                                 houses.RAMC, zodiac.id);
-
-    double geopos[3];
-    geopos[0] = input.location().x();
-    geopos[1] = input.location().y();
-    geopos[2] = 199 /*meters*/; //input.location.z();
-
     ret.sign = &getSign(ret.eclipticPos.x(), zodiac);
     ret.house = getHouse(houses, ret.eclipticPos.x());
     ret.position = getPosition(ret, ret.sign->id);
+    ret.houseRuler.clear();
     int prev = -1;
     for (auto s: qAsConst(ret.homeSigns)) {
         if (s == prev) continue;
@@ -535,6 +638,35 @@ calculatePlanet(PlanetId planet,
     }
     std::sort(ret.houseRuler.begin(),
               ret.houseRuler.end());
+}
+
+// Prime vertical and horizontal coordinates and the angle transits:
+// what depends on where the chart is for, given where the body is.
+void
+localizePlanet(Planet& ret, const Houses& houses, const EphemerisFrame& frame)
+{
+    uint    invertPositionFlag = 256 * 1024;
+    char    errStr[256] = "";
+    double geopos[3] = { frame.geopos[0], frame.geopos[1], frame.geopos[2] };
+
+    // back to the tropical longitude of date the frame works in
+    double xx[3] = { ret.eclipticPos.x(), ret.eclipticPos.y(), ret.distance };
+    if (ret.sweFlags & invertPositionFlag) xx[0] += 180;
+    xx[0] = swe_degnorm(xx[0] + frame.aya);
+
+    // A hack to calculate prime vertical longitude from the campanus
+    // house position; this API wants tropical longitude. From there we
+    // fudge a prime vertical coordinate.
+    double housePos =
+            swe_house_pos(houses.RAMC, frame.geopos[1], frame.epsTrue,
+            'C', xx, errStr);
+    ret.pvPos = (housePos - 1) / 12 * 360;
+
+    // calculate horizontal coordinates
+    double hor[2];
+    frame.toHorizontal(xx, hor);
+    ret.horizontalPos.setX(hor[0]);
+    ret.horizontalPos.setY(hor[1]);
 
     double rettm;
     int eflg = SEFLG_SWIEPH;
@@ -548,10 +680,10 @@ calculatePlanet(PlanetId planet,
 
     double at[4];
     double RA = at[Star::atMC] = ret.equatorialPos.x();
-    double DD = asind(sind(eps) * sind(ablong));
-    double AD = asind(tand(DD) * tand(input.location().y()));
-    double OA = input.location().y() >= 0 ? (RA - AD) : (RA + AD);
-    double OD =input.location().y() >= 0 ? (RA + AD) : (RA - AD);
+    double DD = asind(sind(frame.epsTrue) * sind(xx[0]));
+    double AD = asind(tand(DD) * tand(geopos[1]));
+    double OA = geopos[1] >= 0 ? (RA - AD) : (RA + AD);
+    double OD = geopos[1] >= 0 ? (RA + AD) : (RA - AD);
     // RA - (OAAC - OA)
     at[Star::atAsc] = swe_degnorm(houses.RAMC - (houses.OAAC - OA));
     at[Star::atDesc] = swe_degnorm(houses.RAMC - (houses.ODDC - OD));
@@ -570,7 +702,7 @@ calculatePlanet(PlanetId planet,
                            geopos, 1013.25/*atpress*/, 10/*attemp*/,
                            &rettm, errStr) >= 0)
         {
-            st = swe_degnorm(swe_sidtime(rettm) * 15 + input.location().x());
+            st = swe_degnorm(swe_sidtime(rettm) * 15 + geopos[0]);
             swe_split_deg(st, 0, &deg, &min, &sec, &frac, &sgn);
             //qDebug("  %s %3d %02d %02d", qPrintable(angleDesc[m]), deg, min, sec);
             ret.angleTransit[m] = Planet::timeToDT(rettm);
@@ -591,7 +723,217 @@ calculatePlanet(PlanetId planet,
         qSwap(ret.angleTransit[Star::atAsc], ret.angleTransit[Star::atDesc]);
         qSwap(ret.angleTransit[Star::atMC], ret.angleTransit[Star::atIC]);
     }
+}
+
+// The angles and house cusps as bodies.
+Planet
+anglePlanet(PlanetId id, const Houses& houses)
+{
+    Planet ret = Data::getPlanet(id);
+    if (id == Planet_Asc) {
+        ret.eclipticPos.setX(houses.Asc);
+        ret.equatorialPos.setX(houses.RAAC);
+        ret.pvPos = 0;
+    } else if (id == Planet_Desc) {
+        ret.eclipticPos.setX(swe_degnorm(180.+houses.Asc));
+        ret.equatorialPos.setX(swe_degnorm(180.+houses.RAAC));
+        ret.pvPos = 180;
+    } else if (id == Planet_MC) {
+        ret.eclipticPos.setX(houses.MC);
+        ret.equatorialPos.setX(houses.RAMC);
+        ret.pvPos = 270;
+    } else if (id == Planet_IC) {
+        ret.eclipticPos.setX(swe_degnorm(180.+houses.MC));
+        ret.equatorialPos.setX(swe_degnorm(180.+houses.RAMC));
+        ret.pvPos = 90;
+    } else {
+        ret.eclipticPos.setX(houses.cusp[id - Planet_Asc]);
+        ret.equatorialPos.setX(houses.cusp[id - Planet_Asc]); // XXX
+        ret.pvPos = 30 * (id - Planet_Asc);
+        ret.house = id - Planet_Asc;
+    }
+    return ret;
+}
+
+bool
+isAnglePlanet(PlanetId id)
+{ return id >= Planet_Asc && id <= House_12; }
+
+// Horizontal coordinates and angle transits of a star.
+void
+localizeStar(Star& ret, const InputData& input, const Houses& houses)
+{
+    double  jd = getJulianDate(input.GMT());
+    char    errStr[256] = "";
+    char starName[256];
+    strcpy(starName, ret.name.toStdString().c_str());
+
+    double geopos[3];                  // calculate horizontal coordinates
+    double hor[3];
+    geopos[0] = input.location().x();
+    geopos[1] = input.location().y();
+    geopos[2] = input.location().z();
+    double xx[3] = { ret.equatorialPos.x(), ret.equatorialPos.y(),
+                     ret.distance };
+    swe_azalt(jd, SE_ECL2HOR, geopos, 0, 0, xx, hor);
+    ret.horizontalPos.setX(hor[0]);
+    ret.horizontalPos.setY(hor[1]);
+
+    double rettm;
+    int eflg = SEFLG_SWIEPH;
+
+    for (auto m = Star::atAsc;
+         m < Star::numAngles;
+         m = Star::angleTransitMode(m + 1)) 
+    {
+        if (swe_rise_trans(houses.startSpeculum, -1, starName,
+                           eflg, Star::angleTransitFlag(m),
+                           geopos, 1013.25, 10,
+                           &rettm, errStr) >= 0) {
+            ret.angleTransit[m] = Planet::timeToDT(rettm);
+        }
+    }
+}
+
+// Asc, MC and ARMC alone, for the root finders. swe_houses_ex2() works
+// out a full set of cusps (and their speeds) just to hand back the
+// angles; these are the same closed forms it uses for them, and the
+// tropical angles are kept per thread for the last jd and place asked
+// about, since both angles, and often both sides of a midpoint, get
+// asked for at each step.
+constexpr double armcSpeed = 366.24219893 / 365.24219893 * 360;
+
+struct angleFrame {
+    double jd = 0, lat = 0, lon = 0;
+    bool valid = false;
+    double jdut, armc, mc, asc;
+    double mcSpeed, ascSpeed;
+
+    int sidMode = -1;
+    double ayanamsa = 0;
+
+    // d(Asc1(x))/d(ARMC), as in swehouse.c
+    static double
+    ascDash(double x, double sine, double cose, double tanfi)
+    {
+        double cosx = cosd(x), sinx = sind(x);
+        double sinx2 = sinx * sinx;
+        double c = cose * cosx - tanfi * sine;
+        double d = sinx2 + c * c;
+        return (d > VERY_SMALL? (cosx * c + cose * sinx2) / d : 0) * armcSpeed;
+    }
+
+    void
+    compute(double et, double geolat, double geolon)
+    {
+        if (valid && jd == et && lat == geolat && lon == geolon) return;
+
+        jdut = getUTfromET(et);
+        char errStr[256];
+        double xn[6];
+        swe_calc_ut(jdut, SE_ECL_NUT, 0, xn, errStr);
+        double eps = xn[0];
+        armc = swe_degnorm(swe_sidtime0(jdut, eps, xn[2]) * 15 + geolon);
+
+        double fi = qBound(-90 + VERY_SMALL, geolat, 90 - VERY_SMALL);
+        double sine = sind(eps), cose = cosd(eps);
+        double tanfi = tand(fi);
+        double sina = sind(armc), cosa = cosd(armc);
+
+        mc = swe_degnorm(atan2d(sina, cosa * cose));
+        asc = swe_degnorm(atan2d(cosa, -(sina * cose + tanfi * sine)));
+        mcSpeed = ascDash(armc, sine, cose, 0);
+        ascSpeed = ascDash(armc + 90, sine, cose, tanfi);
+
+        // within the polar circle, once the MC sinks below the horizon
+        // the Asc is on the western side, and Campanus turns both
+        // around; so must we, to agree with the natal angles
+        if (fabs(fi) >= 90 - eps && swe_difdeg2n(asc, mc) < 0) {
+            asc = swe_degnorm(asc + 180);
+            mc = swe_degnorm(mc + 180);
+        }
+
+        jd = et, lat = geolat, lon = geolon;
+        valid = true;
+        sidMode = -1;
+    }
+
+    // caller has already done swe_set_sid_mode(mode)
+    double
+    ayanamsaFor(int mode)
+    {
+        if (sidMode != mode) {
+            char errStr[256];
+            swe_get_ayanamsa_ex_ut(jdut, SEFLG_SWIEPH, &ayanamsa, errStr);
+            sidMode = mode;
+        }
+        return ayanamsa;
+    }
+};
+
+thread_local angleFrame st_angles;
+
+// Positions already worked out by PlanetLoc::compute, by jd and body.
+// One step of a search asks for the same body over and over: for each
+// pair it's in, each cloned profile, and both halves of every midpoint.
+// Direct-mapped and per thread, so a collision just means computing it
+// again.
+struct bodyMemo {
+    static constexpr unsigned size = 256;
+
+    struct entry {
+        double jd = 0, lat = 0, lon = 0;
+        int id = -1;
+        uint flags = 0;
+        int sidMode = 0;
+        int mode = amcUnknown;
+        qreal pos = 0, speed = 0;
+
+        bool
+        matches(double jd_, int id_, uint flags_, int sidMode_, int mode_,
+                double lat_, double lon_) const
+        {
+            return id == id_ && jd == jd_ && flags == flags_
+                    && sidMode == sidMode_ && mode == mode_
+                    && lat == lat_ && lon == lon_;
+        }
+    };
+
+    entry slots[size];
+
+    entry&
+    slot(double jd, int id, int mode)
+    {
+        size_t h = std::hash<double>()(jd);
+        h ^= (size_t(id) << 2 | size_t(mode & 3)) * 0x9e3779b97f4a7c15ull;
+        return slots[(h ^ h >> 29) % size];
+    }
+};
+
+thread_local bodyMemo st_bodies;
 
+} // anonymous-namespace
+
+Planet 
+calculatePlanet(PlanetId planet,
+                const InputData& input,
+                const Houses& houses,
+                const Zodiac& zodiac)
+{
+    return calculatePlanet(planet, input, houses, zodiac,
+                           EphemerisFrame(input, zodiac.id));
+}
+
+Planet
+calculatePlanet(PlanetId planet,
+                const InputData& input,
+                const Houses& houses,
+                const Zodiac& zodiac,
+                const EphemerisFrame& frame)
+{
+    Planet ret = calculatePlanet(planet, frame);
+    placePlanet(ret, houses, zodiac);
+    localizePlanet(ret, houses, frame);
     return ret;
 }
 
@@ -624,29 +966,58 @@ PlanetLoc::compute(const ChartPlanetId& planet,
     if (ida.zodiac() > 1) {
         trop = false;
         flags |= SEFLG_SIDEREAL;
-        swe_set_sid_mode(ida.zodiac() - 2, 0, 0);
     }
+    int sidMode = ida.zodiac() - 2;
+
+    // sidereal mode and obliquity are only needed when we actually go
+    // to the ephemeris, which the cache often saves us from
+    bool sidSet = trop;
+    auto prepSidereal = [&] {
+        if (sidSet) return;
+        swe_set_sid_mode(sidMode, 0, 0);
+        sidSet = true;
+    };
 
     double xx[6];
-    swe_calc_ut(jd, SE_ECL_NUT, 0, xx, errStr);
-    auto eps = xx[0];
+    double eps = 0;
+    bool haveEps = false;
+    auto getEps = [&] {
+        if (!haveEps) {
+            double xn[6];
+            swe_calc_ut(jd, SE_ECL_NUT, 0, xn, errStr);
+            eps = xn[0];
+            haveEps = true;
+        }
+        return eps;
+    };
 
     typedef std::pair<double,double> posSpd;
     auto getAscMC = [&](unsigned i, bool trop = false)
             -> posSpd
     {
-        double cusps[14], cuspspd[14], ascmc[11], ascmcspd[11];
-        auto jdut = getUTfromET(jd);
-        uint flags = SEFLG_SWIEPH;
-        if (!trop) flags |= SEFLG_SIDEREAL;
-        swe_houses_ex2(jdut, flags,
-                      ida.location().y(), ida.location().x(),
-                      'C', cusps, ascmc, cuspspd, ascmcspd,
-                       errStr);
-        return { ascmc[i], ascmcspd[i] };
+        auto& af = st_angles;
+        af.compute(jd, ida.location().y(), ida.location().x());
+        if (i == 2) return { af.armc, armcSpeed };
+
+        posSpd ret = i == 0? posSpd(af.asc, af.ascSpeed)
+                           : posSpd(af.mc, af.mcSpeed);
+        if (!trop) {
+            prepSidereal();
+            ret.first = swe_degnorm(ret.first - af.ayanamsaFor(sidMode));
+        }
+        return ret;
     };
 
+    const int mode = aspectModeEnum(aspectMode);
+    const double lat = ida.location().y(), lon = ida.location().x();
+
     auto getPos = [&](const Planet& p, qreal& speed) -> qreal {
+        auto& memo = st_bodies.slot(jd, p.id, mode);
+        if (memo.matches(jd, p.id, flags, sidMode, mode, lat, lon)) {
+            speed = memo.speed;
+            return memo.pos;
+        }
+
         int ret = ERR;
         qreal pos = 0.0;
         switch (aspectMode) {
@@ -661,7 +1032,12 @@ PlanetLoc::compute(const ChartPlanetId& planet,
                 if (p.id==Planet_IC) pos = swe_degnorm(pos+180.);
                 ret = OK;
                 // FIXME speed?
+            } else if (EphemerisCache::lookup(p.sweNum, flags, sidMode,
+                                              jd, pos, speed)) {
+                if (p.id==Planet_SouthNode) pos = swe_degnorm(pos+180.);
+                ret = OK;
             } else {
+                prepSidereal();
                 ret = swe_calc_ut(jd, p.sweNum, flags, xx, errStr);
                 pos = xx[0];
                 if (p.id==Planet_SouthNode) pos = swe_degnorm(pos+180.);
@@ -674,7 +1050,7 @@ PlanetLoc::compute(const ChartPlanetId& planet,
                 double xx[6];
                 std::tie(xx[0],speed) = getAscMC(0, true/*trop*/);
                 xx[1] = 0, xx[2] = 1.0;
-                swe_cotrans(xx, xx, -eps);
+                swe_cotrans(xx, xx, -getEps());
                 pos = xx[0];
                 if (p.id==Planet_Desc) pos = swe_degnorm(pos+180.);
                 ret = OK;
@@ -685,13 +1061,17 @@ PlanetLoc::compute(const ChartPlanetId& planet,
                 if (p.id==Planet_IC) pos = swe_degnorm(pos+180.);
                 ret = OK;
             } else {
-                ret = swe_calc_ut(jd, p.sweNum,
-                                  (flags & ~SEFLG_SIDEREAL)
-                                  | SEFLG_EQUATORIAL | SEFLG_SPEED,
-                                  xx, errStr);
-                pos = xx[0];
+                uint eqFlags = (flags & ~SEFLG_SIDEREAL)
+                        | SEFLG_EQUATORIAL | SEFLG_SPEED;
+                if (EphemerisCache::lookup(p.sweNum, eqFlags, sidMode,
+                                           jd, pos, speed)) {
+                    ret = OK;
+                } else {
+                    ret = swe_calc_ut(jd, p.sweNum, eqFlags, xx, errStr);
+                    pos = xx[0];
+                    speed = xx[3];
+                }
                 if (p.id==Planet_SouthNode) pos = swe_degnorm(pos+180.);
-                speed = xx[3];
             }
             break;
 
@@ -710,15 +1090,22 @@ PlanetLoc::compute(const ChartPlanetId& planet,
                 ret = swe_calc_ut(jd, p.sweNum,
                                   flags & ~SEFLG_SIDEREAL,
                                   xx, errStr);
-                auto housePos = swe_house_pos(getAscMC(2,true/*trop*/).first,
-                                              ida.location().y(), eps,
+                auto armc = getAscMC(2,true/*trop*/).first;
+                auto housePos = swe_house_pos(armc,
+                                              ida.location().y(), getEps(),
                                               'C', xx, errStr);
                 pos = (housePos - 1)/12*360;
             }
             break;
         }
         }
-        if (ret != ERR) return pos;
+        if (ret != ERR) {
+            memo.jd = jd, memo.id = p.id, memo.flags = flags;
+            memo.sidMode = sidMode, memo.mode = mode;
+            memo.lat = lat, memo.lon = lon;
+            memo.pos = pos, memo.speed = speed;
+            return pos;
+        }
         qDebug() << "Can't calculate position of " << p1.name
                  << "at jd" << jd << ":" << errStr;
         return 0;
@@ -767,8 +1154,8 @@ PlanetLoc::defaultSpeed() const
 
 /*static*/
 std::pair<qreal, qreal>
-PlanetProfile::computeDelta(const Loc* a,
-                            const Loc* b,
+PlanetProfile::computeDelta(qreal aloc, qreal aspeed,
+                            qreal bloc, qreal bspeed,
                             unsigned int h /*=1*/)
 {
     // It is not obvious what needs to happen here.
@@ -784,11 +1171,11 @@ PlanetProfile::computeDelta(const Loc* a,
     // need to compute spread and position? There is more than one
     // value, but we only have one degree of freedom (one input variable)
     // to control...
-    qreal speed = (a->speed + b->speed);
+    qreal speed = (aspeed + bspeed);
     if (h>1) speed *= qreal(h);
 
-    qreal apos = h>1? harmonic(h,a->loc) : a->loc;
-    qreal bpos = h>1? harmonic(h,b->loc) : b->loc;
+    qreal apos = h>1? harmonic(h,aloc) : aloc;
+    qreal bpos = h>1? harmonic(h,bloc) : bloc;
 
     if (bpos - apos > 180) bpos -= 360;
     else if (apos - bpos > 180) bpos += 360;
@@ -880,6 +1267,132 @@ PlanetProfile::computeSpread()
     return maxa;
 }
 
+void
+FlatProfile::assign(const PlanetProfile& prof)
+{
+    auto n = prof.size();
+    ids.assign(n, ChartPlanetId());
+    loc.resize(n);
+    rasi.resize(n);
+    speed.resize(n);
+    kind.resize(n);
+    allow.assign(n, PlanetLoc::aspAll);
+    knownJD.assign(n, 0);
+    input.assign(n, nullptr);
+    column.assign(n, -1);
+
+    for (unsigned i = 0; i < n; ++i) {
+        auto l = prof[i];
+        loc[i] = rasi[i] = l->loc;
+        speed[i] = l->speed;
+        auto ploc = dynamic_cast<const PlanetLoc*>(l);
+        if (!ploc) {
+            kind[i] = flatOther;
+            continue;
+        }
+        ids[i] = ploc->planet;
+        rasi[i] = ploc->rasiLoc();
+        allow[i] = ploc->allowAspects;
+        input[i] = &ploc->input();
+        if (auto known = dynamic_cast<const KnownPosition*>(ploc)) {
+            kind[i] = flatKnown;
+            knownJD[i] = known->julianDate();
+        } else {
+            kind[i] = ploc->inMotion()? flatTransit : flatFixed;
+        }
+    }
+}
+
+void
+FlatProfile::computeAt(double jd)
+{
+    int row = timeline? timeline->row(jd) : -1;
+    for (unsigned i = 0, n = size(); i < n; ++i) {
+        if (kind[i] == flatTransit) {
+            if (row >= 0 && column[i] >= 0) {
+                rasi[i] = timeline->loc(row, column[i]);
+                speed[i] = timeline->speed(row, column[i]);
+            } else {
+                std::tie(rasi[i], speed[i]) =
+                        PlanetLoc::compute(ids[i], *input[i], jd);
+            }
+            loc[i] = rasi[i];
+        } else if (kind[i] == flatFixed) {
+            loc[i] = rasi[i];
+        }
+    }
+}
+
+void
+FlatProfile::useTimeline(const TransitTimeline* tl)
+{
+    timeline = tl;
+    for (unsigned i = 0, n = size(); i < n; ++i) {
+        column[i] = -1;
+        if (!tl || kind[i] != flatTransit) continue;
+        if (!tl->serves(*input[i])) continue;
+        column[i] = tl->column(ids[i]);
+    }
+}
+
+void
+FlatProfile::view(const PlanetSet& ps, View& v) const
+{
+    v.prof = this;
+    v.idx.clear();
+    for (unsigned i = 0, n = size(); i < n && v.idx.size() < ps.size(); ++i) {
+        if (kind[i] != flatOther && ps.count(ids[i])) v.idx.push_back(i);
+    }
+}
+
+void
+FlatProfile::viewAll(View& v) const
+{
+    v.prof = this;
+    v.idx.resize(size());
+    for (unsigned i = 0, n = size(); i < n; ++i) v.idx[i] = i;
+}
+
+void
+FlatProfile::append(const FlatProfile& from, unsigned i)
+{
+    ids.push_back(from.ids[i]);
+    loc.push_back(from.loc[i]);
+    rasi.push_back(from.rasi[i]);
+    speed.push_back(from.speed[i]);
+    kind.push_back(from.kind[i]);
+    allow.push_back(from.allow[i]);
+    knownJD.push_back(from.knownJD[i]);
+    input.push_back(from.input[i]);
+    column.push_back(from.column[i]);
+}
+
+FlatProfile
+FlatProfile::subset(const PlanetSet& ps) const
+{
+    View v;
+    view(ps, v);
+    FlatProfile ret;
+    ret.timeline = timeline;
+    for (auto i : v.idx) ret.append(*this, i);
+    return ret;
+}
+
+void
+FlatProfile::swap(FlatProfile& other)
+{
+    ids.swap(other.ids);
+    loc.swap(other.loc);
+    rasi.swap(other.rasi);
+    speed.swap(other.speed);
+    kind.swap(other.kind);
+    allow.swap(other.allow);
+    knownJD.swap(other.knownJD);
+    input.swap(other.input);
+    column.swap(other.column);
+    std::swap(timeline, other.timeline);
+}
+
 Star calculateStar(const QString& name,
                    const InputData& input,
                    const Houses& houses,
@@ -918,29 +1431,7 @@ Star calculateStar(const QString& name,
             ret.equatorialPos.setY(xx[1]);
         }
 
-        double geopos[3];                  // calculate horizontal coordinates
-        double hor[3];
-        geopos[0] = input.location().x();
-        geopos[1] = input.location().y();
-        geopos[2] = input.location().z();
-        swe_azalt(jd, SE_ECL2HOR, geopos, 0, 0, xx, hor);
-        ret.horizontalPos.setX(hor[0]);
-        ret.horizontalPos.setY(hor[1]);
-
-        double rettm;
-        int eflg = SEFLG_SWIEPH;
-
-        for (auto m = Star::atAsc;
-             m < Star::numAngles;
-             m = Star::angleTransitMode(m + 1)) 
-        {
-            if (swe_rise_trans(houses.startSpeculum, -1, starName,
-                               eflg, Star::angleTransitFlag(m),
-                               geopos, 1013.25, 10,
-                               &rettm, errStr) >= 0) {
-                ret.angleTransit[m] = Planet::timeToDT(rettm);
-            }
-        }
+        localizeStar(ret, input, houses);
     } else {
         qDebug("A: can't calculate position of '%s' at julian day %f: %s",
                qPrintable(ret.name), jd, errStr);
@@ -1049,7 +1540,9 @@ calculateHouses( const InputData& input )
 }
 
 PlanetPower 
-calculatePlanetPower(const Planet& planet, const Horoscope& scope)
+calculatePlanetPower(const Planet& planet,
+                     const Horoscope& scope,
+                     aspectModeEnum mode)
 {
     PlanetPower ret;
 
@@ -1102,7 +1595,7 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     case Planet_Mars:
     case Planet_Jupiter:
     case Planet_Saturn:
-        if (isEarlier(planet, scope.sun))
+        if (isEarlier(planet, scope.sun, mode))
             ret.dignity += 2;
         else
             ret.deficient -= 2;
@@ -1110,7 +1603,7 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     case Planet_Mercury:
     case Planet_Venus:
     case Planet_Moon:
-        if (!isEarlier(planet, scope.sun))
+        if (!isEarlier(planet, scope.sun, mode))
             ret.dignity += 2;
         else
             ret.deficient -= 2;
@@ -1119,16 +1612,16 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     }
 
     if (planet.id != Planet_Sun) {
-        if (angle(planet, scope.sun) > 9) // not burned by sun
+        if (angle(planet, scope.sun, mode) > 9) // not burned by sun
             ret.dignity += 5;
-        else if (angle(planet, scope.sun) < 0.4) // 'in cazimo'
+        else if (angle(planet, scope.sun, mode) < 0.4) // 'in cazimo'
             ret.dignity += 5;
         else // burned by sun
             ret.deficient -= 4;
     }
 
     if (planet.id != Planet_Jupiter)
-    switch (aspect(planet, scope.jupiter, topAspectSet())) {
+    switch (aspect(planet, scope.jupiter, topAspectSet(), mode)) {
     case Aspect_Conjunction: ret.dignity += 5; break;
     case Aspect_Trine:       ret.dignity += 4; break;
     case Aspect_Sextile:     ret.dignity += 3; break;
@@ -1136,7 +1629,7 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     }
 
     if (planet.id != Planet_Venus)
-    switch (aspect(planet, scope.venus, topAspectSet())) {
+    switch (aspect(planet, scope.venus, topAspectSet(), mode)) {
     case Aspect_Conjunction: ret.dignity += 5; break;
     case Aspect_Trine:       ret.dignity += 4; break;
     case Aspect_Sextile:     ret.dignity += 3; break;
@@ -1144,7 +1637,7 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     }
 
     if (planet.id != Planet_NorthNode)
-    switch (aspect(planet, scope.northNode, topAspectSet())) {
+    switch (aspect(planet, scope.northNode, topAspectSet(), mode)) {
     case Aspect_Conjunction:
     /*case Aspect_Trine:
     case Aspect_Sextile:     ret.dignity   += 4; break;
@@ -1153,7 +1646,7 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     }
 
     if (planet.id != Planet_Mars)
-    switch (aspect(planet, scope.mars, topAspectSet())) {
+    switch (aspect(planet, scope.mars, topAspectSet(), mode)) {
     case Aspect_Conjunction: ret.deficient -= 5; break;
     case Aspect_Opposition:  ret.deficient -= 4; break;
     case Aspect_Quadrature:  ret.deficient -= 3; break;
@@ -1161,20 +1654,20 @@ calculatePlanetPower(const Planet& planet, const Horoscope& scope)
     }
 
     if (planet.id != Planet_Saturn)
-    switch (aspect(planet, scope.saturn, topAspectSet())) {
+    switch (aspect(planet, scope.saturn, topAspectSet(), mode)) {
     case Aspect_Conjunction: ret.deficient -= 5; break;
     case Aspect_Opposition:  ret.deficient -= 4; break;
     case Aspect_Quadrature:  ret.deficient -= 3; break;
     default: break;
     }
 
-    if (aspect(planet, scope.stars["Regulus"], tightConjunction()) == Aspect_Conjunction)
+    if (aspect(planet, scope.stars["Regulus"], tightConjunction(), mode) == Aspect_Conjunction)
         ret.dignity += 6;                  // Regulus coordinates at 2000year: 29LEO50, +00.27'
 
-    if (aspect(planet, scope.stars["Spica"], tightConjunction()) == Aspect_Conjunction)
+    if (aspect(planet, scope.stars["Spica"], tightConjunction(), mode) == Aspect_Conjunction)
         ret.dignity += 5;                  // Spica coordinates at 2000year: 23LIB50, -02.03'
 
-    if (aspect(planet, scope.stars["Algol"], tightConjunction()) == Aspect_Conjunction)
+    if (aspect(planet, scope.stars["Algol"], tightConjunction(), mode) == Aspect_Conjunction)
         ret.deficient -= 5;                // Algol coordinates at 2000year: 26TAU10, +22.25'
 
     return ret;
@@ -1293,20 +1786,40 @@ calculateAspects(const AspectsSet& aspectSet,
     return ret;
 }
 
-void 
-findPlanetStarConfigs(const PlanetMap& planets, StarMap& stars)
+void
+StarIndex::rebuild(const StarMap& stars)
 {
-    modalize<aspectModeType> aspects(aspectMode, amcGreatCircle);
+    _ecliptic.clear();
+    _ecliptic.reserve(size_t(stars.size()));
+    for (auto it = stars.cbegin(); it != stars.cend(); ++it) {
+        _ecliptic.push_back({ swe_degnorm(it->eclipticPos.x()), it.key() });
+    }
+    std::sort(_ecliptic.begin(), _ecliptic.end());
+}
 
-    for (Star& s : stars.values()) s.configuredWithPlanet = Planet_None;
+void 
+findPlanetStarConfigs(const PlanetMap& planets,
+                      StarMap& stars,
+                      const StarIndex& index)
+{
+    for (Star& s : stars) s.configuredWithPlanet = Planet_None;
 
-    for (PlanetId pid : planets.keys()) {
-        const Planet& p(planets[pid]);
-        for (const std::string& name : stars.keys()) {
+    // The great circle distance is never less than the difference in
+    // longitude, so only the stars that close need a look.
+    const AspectsSet& conj(tightConjunction());
+    for (const Planet& p : planets) {
+        auto check = [&](const std::string& name) {
             Star& s(stars[name]);
-            if (aspect(p, s, tightConjunction()) != Aspect_None) {
+            if (aspect(p, s, conj, amcGreatCircle) != Aspect_None) {
                 s.configuredWithPlanet = p.id;
             }
+        };
+        for (const AspectType& at : conj.aspects) {
+            if (!at.isEnabled()) continue;
+            index.forEachNear(p.eclipticPos.x() + at.angle, at.orb(), check);
+            if (at.angle != 0) {
+                index.forEachNear(p.eclipticPos.x() - at.angle, at.orb(), check);
+            }
         }
     }
 }
@@ -1414,15 +1927,11 @@ hasPlanetGroupInLowerHarmonic(const PlanetHarmonics& harmonics,
         auto hat = harmonics.find(lower);
         if (hat == harmonics.end()) continue;
 #if 1
-        for (auto hit : hat->second) {
-            bool foundAll = true;
-            for (auto pit : plist) {
-                if (hit.first.count(pit) == 0) {
-                    foundAll = false;
-                    break;
-                }
-            }
-            if (foundAll) {
+        for (const auto& hit : hat->second) {
+            // both sorted the same way, so one pass over each
+            if (std::includes(hit.first.begin(), hit.first.end(),
+                              plist.begin(), plist.end()))
+            {
                 return true;
             }
         }
@@ -1437,28 +1946,6 @@ hasPlanetGroupInLowerHarmonic(const PlanetHarmonics& harmonics,
     return false;
 }
 
-bool
-meetsQuorum(const PlanetQueue& curr,
-            const std::set<int>& needs,
-            unsigned int quorum)
-{
-    std::map<int, int> counts;
-    //std::map<int, bool> hasSolo;
-    unsigned q = 0;
-    //for (int need : needs) { counts[need] = 0; hasSolo[need] = false; }
-    for (const PlanetLoc& pl : curr) {
-        //if (pl.planet.notwo()) hasSolo[pl.planet.fileId()] = true;
-        int n = pl.planet.isSolo() ? 1 : 2;
-        q += n, counts[pl.planet.fileId()] += n;
-        //++q, ++counts[pl.planet.fileId()];
-    }
-    if (q < quorum) return false;
-    for (int need : needs) {
-        if (counts[need] == 0 /*|| !hasSolo[need]*/) return false;
-    }
-    return true;
-}
-
 bool 
 outOfOrb(const PlanetLoc& a,
          const PlanetLoc& b,
@@ -1496,65 +1983,8 @@ cluster(const PlanetRange& in, qreal orb)
     return qs;
 }
 
-typedef std::tuple<unsigned, qreal, bool> quorumOrbCleanup;
-typedef std::vector<quorumOrbCleanup> looper;
 typedef std::pair<unsigned, PlanetGroups> harmonicResult;
 
-class joiner {
-    PlanetHarmonics& hx;
-    std::vector<bool>& sieve;
-
-    typedef std::list<ChartPlanetBitmap> cpbList;
-    std::map<unsigned, cpbList> seen;
-
-public:
-    joiner(PlanetHarmonics& hxIn,
-           std::vector<bool>& primeSieve) :
-        hx(hxIn), sieve(primeSieve)
-    { }
-
-    void operator()(uintMSet& completed, const harmonicResult& res)
-    {
-        completed.insert(res.first);
-        if (sieve[res.first]) {
-            hx[res.first] = res.second;
-            for (auto g : res.second) {
-                if (!g.first.containsMidPt())
-                    seen[res.first].push_back(g.first);
-            }
-            return;
-        }
-
-        uintMSet factors = getAllFactors(res.first);
-        for (auto g : res.second) {
-            if (!g.first.containsMidPt()) {
-                ChartPlanetBitmap cpb(g.first);
-                bool found = false;
-                for (unsigned lh : factors) {
-                    for (const auto& lcpb : seen[lh]) {
-                        if (lcpb.contains(cpb)) {
-#if 0
-                            qDebug() << QString("H%1").arg(lh)
-                                     << PlanetSet(lcpb).names()
-                                     << "already contains"
-                                     << QString("H%1").arg(res.first)
-                                     << PlanetSet(cpb).names();
-#endif
-                            found = true;
-                            break;
-                        }
-                    }
-                    if (found) break;
-                }
-                if (found) continue;
-                seen[res.first].push_back(cpb);
-            }
-
-            hx[res.first].insert(g);
-        }
-    }
-};
-
 std::vector<bool>
 getPrimeSieve(unsigned top)
 {
@@ -1580,197 +2010,310 @@ uintMSet getPrimes(unsigned top)
     return ret;
 }
 
-void
-findHarmonics(const ChartPlanetMap& cpm,
-              PlanetHarmonics& hx,
-              const looper& loop,
-              bool doMidpoints = false)
-{
-    std::set<int> needsFiles;
-    for (const ChartPlanetId& cpi : cpm.keys()) {
-        needsFiles.insert(cpi.fileId());
-    }
-
-    const unsigned minQuorum = harmonicsMinQuorum();
-    const unsigned maxH = maxHarmonic();
-
-    // Creates a prime sieve and a sequence of numbers which is has primes
-    // less than or equal to the primeFactorLimit and non-primes with
-    // no factors less than or equal to the primeFactorLimit.
-    static std::vector<bool> primeSieve;
-    static std::set<unsigned> seq;
-    static unsigned lastMaxH = 0;
-    static unsigned lastPFL = 0;
-    if (maxH > lastMaxH || lastPFL != primeFactorLimit()) {
-        std::set<unsigned> primes { 1 }, nonPrimes;
-        primeSieve.assign(maxH+1,true);
-        std::vector<bool> maxFactor(maxH+1,false);
-        for (unsigned int i = 2; i <= maxH; ++i) {
-            if (!primeSieve[i]) {
-                if (!maxFactor[i]) nonPrimes.insert(i);
-                continue;
-            }
-            bool beyond = i > primeFactorLimit();
-            if (!beyond) primes.insert(i);
-            for (unsigned int j = i+i; j <= maxH; j += i) {
-                primeSieve[j] = false;
-                maxFactor[j] = beyond;
-            }
-        }
-        seq = primes;
-        seq.insert(nonPrimes.cbegin(), nonPrimes.cend());
-        lastPFL = primeFactorLimit();
-    } else if (maxH < lastMaxH) {
-        auto zap = seq.lower_bound(maxH+1);
-        while (zap != seq.end()) {
-            seq.erase(zap++);
-        }
-    }
-    lastMaxH = maxH;
+namespace {
 
-    auto computePositions = [&](unsigned h,
-                                PlanetRange& allOfThem,
-                                bool doMidpoints = false)
+// The chart points findHarmonics() clusters, flat: bodies first, then
+// for each pair of bodies in the same chart the midpoint and its
+// opposite. Points are ranked by ChartPlanetId, so sorting by (position,
+// rank) orders them the way PlanetRange would.
+struct harmonicPoints {
+    std::vector<ChartPlanetId> ids;
+    std::vector<unsigned> rank;
+    std::vector<unsigned char> weight;  // toward the quorum
+    std::vector<unsigned> fileSlot;     // which of the needed files
+    std::vector<qreal> base;            // by body
+    std::vector<std::pair<unsigned, unsigned>> pairs;
+    std::vector<int> files;             // by slot
+    unsigned numSlots = 0;
+
+    harmonicPoints(const ChartPlanetMap& cpm,
+                   aspectModeEnum mode,
+                   bool doMidpoints)
     {
         for (auto cpit = cpm.cbegin(); cpit != cpm.cend(); ++cpit) {
-            Planet p = cpit.value();
-            if (h > 1) calculateHarmonic(h, p);
-
-            qreal loc;
-            if (aspectMode == amcEcliptic) {
-                loc = p.eclipticPos.x();
-            } else if (aspectMode == amcEquatorial) {
-                loc = p.equatorialPos.x();
+            const Planet& p = cpit.value();
+            if (mode == amcEcliptic) {
+                base.push_back(p.eclipticPos.x());
+            } else if (mode == amcEquatorial) {
+                base.push_back(p.equatorialPos.x());
             } else {
-                loc = p.pvPos;
+                base.push_back(p.pvPos);
             }
-            allOfThem.insert(PlanetLoc(cpit.key(), loc));
-
-            if (!doMidpoints) continue;
+            ids.push_back(cpit.key());
+            weight.push_back(1);
+            int fid = cpit.key().fileId();
+            if (files.empty() || files.back() != fid) files.push_back(fid);
+            fileSlot.push_back(unsigned(files.size() - 1));
+        }
+        numSlots = unsigned(files.size());
 
-            for (auto cpot = std::next(cpit);
-                 cpot != cpm.cend()
-                 && cpit.key().fileId() == cpot.key().fileId();
-                 ++cpot)
+        for (unsigned a = 0; doMidpoints && a < base.size(); ++a) {
+            for (unsigned b = a + 1;
+                 b < base.size() && ids[a].fileId() == ids[b].fileId();
+                 ++b)
             {
-                Planet p2 = cpot.value();
-                if (h > 1) calculateHarmonic(h, p2);
-
-                qreal loc1 = loc;
-                qreal loc2;
-                if (aspectMode == amcEcliptic) {
-                    loc2 = p2.eclipticPos.x();
-                } else if (aspectMode == amcEquatorial) {
-                    loc2 = p2.equatorialPos.x();
-                } else {
-                    loc2 = p2.pvPos;
+                int fid = ids[a].fileId();
+                pairs.emplace_back(a, b);
+                ids.emplace_back(fid, ids[a].planetId(), ids[b].planetId());
+                ids.emplace_back(fid, ids[b].planetId(), ids[a].planetId());
+                for (int opp = 0; opp < 2; ++opp) {
+                    weight.push_back(2);
+                    fileSlot.push_back(fileSlot[a]);
                 }
-
-                if (loc1 > loc2) qSwap(loc1, loc2);
-                if (loc2 - loc1 > 180) loc1 += 360;
-                loc2 = fmod((loc1 + loc2) / 2, 360.);
-
-                allOfThem.insert(PlanetLoc(cpit.key().fileId(),
-                                           cpit.key().planetId(),
-                                           cpot.key().planetId(), loc2));
-                allOfThem.insert(PlanetLoc(cpit.key().fileId(),
-                                           cpot.key().planetId(),
-                                           cpit.key().planetId(),
-                                           fmod(loc2 + 180, 360.)));
             }
         }
-    };
 
-    auto cluster = [&](PlanetGroups& groups,
-                       const quorumOrbCleanup& l,
-                       const PlanetRange& allOfThem)
+        std::vector<unsigned> byId(ids.size());
+        std::iota(byId.begin(), byId.end(), 0);
+        std::sort(byId.begin(), byId.end(), [this](unsigned i, unsigned j) {
+            return ids[i] < ids[j];
+        });
+        rank.resize(ids.size());
+        for (unsigned r = 0; r < byId.size(); ++r) rank[byId[r]] = r;
+    }
+
+    unsigned bodies() const { return unsigned(base.size()); }
+
+    unsigned slot(int fileId) const
     {
-        unsigned quorum;
-        qreal orb;
-        bool cleanup;
-        std::tie(quorum,orb,cleanup) = l;
+        return unsigned(std::find(files.begin(), files.end(), fileId)
+                        - files.begin());
+    }
+};
+
+// Per-thread working storage for one harmonic at a time; it only ever
+// grows, so after the first few harmonics nothing is allocated but the
+// groups found.
+struct harmonicScratch {
+    std::vector<qreal> loc;             // by point
+    std::vector<unsigned> order;        // points by position
+    std::vector<unsigned> window;       // consumed from the front
+    std::vector<unsigned> counts;       // by file slot
+};
 
-        PlanetSet plist;
+thread_local harmonicScratch st_harmonicScratch;
 
-        // Let's see if anything wraps around...
-        ChartPlanetId seen;
-        bool wrapped = false;
+// Positions of the bodies (and midpoints) in harmonic h, and the
+// points sorted by them.
+void
+harmonicPositions(const harmonicPoints& pts,
+                  unsigned h,
+                  bool midpoints,
+                  harmonicScratch& s)
+{
+    unsigned n = pts.bodies();
+    if (midpoints) n += 2 * unsigned(pts.pairs.size());
+    s.loc.resize(n);
+    for (unsigned i = 0; i < pts.bodies(); ++i) {
+        s.loc[i] = h > 1 ? harmonic(h, pts.base[i]) : pts.base[i];
+    }
+    for (unsigned k = 0; midpoints && k < pts.pairs.size(); ++k) {
+        qreal loc1 = s.loc[pts.pairs[k].first];
+        qreal loc2 = s.loc[pts.pairs[k].second];
+        if (loc1 > loc2) qSwap(loc1, loc2);
+        if (loc2 - loc1 > 180) loc1 += 360;
+        loc2 = fmod((loc1 + loc2) / 2, 360.);
+        s.loc[pts.bodies() + 2*k] = loc2;
+        s.loc[pts.bodies() + 2*k + 1] = fmod(loc2 + 180, 360.);
+    }
+
+    s.order.resize(n);
+    std::iota(s.order.begin(), s.order.end(), 0);
+    std::sort(s.order.begin(), s.order.end(), [&](unsigned i, unsigned j) {
+        return s.loc[i] < s.loc[j]
+                || (s.loc[i] == s.loc[j] && pts.rank[i] < pts.rank[j]);
+    });
+}
+
+bool
+meetsQuorum(const harmonicPoints& pts,
+            harmonicScratch& s,
+            size_t head,
+            unsigned quorum)
+{
+    unsigned q = 0;
+    s.counts.assign(pts.numSlots, 0);
+    for (size_t w = head; w < s.window.size(); ++w) {
+        unsigned i = s.window[w];
+        q += pts.weight[i];
+        s.counts[pts.fileSlot[i]] += pts.weight[i];
+    }
+    if (q < quorum) return false;
+    for (unsigned c : s.counts) {
+        if (c == 0) return false;
+    }
+    return true;
+}
+
+// One sweep around the circle of sorted points: the window holds the
+// points within orb of its first, wrapping from the top of the zodiac
+// into the bottom, and whenever a point falls out of orb the window
+// is offered to groups before it is trimmed from the front.
+void
+harmonicCluster(const harmonicPoints& pts,
+                harmonicScratch& s,
+                PlanetGroups& groups,
+                unsigned quorum,
+                qreal orb,
+                unsigned minQuorum,
+                bool requireAnchor)
+{
+    const auto& o = s.order;
+    unsigned n = unsigned(o.size());
+    if (n == 0) return;
+
+    auto outOfOrb = [&](unsigned a, unsigned b) {
+        return angle(s.loc[a], s.loc[b]) > orb;
+    };
+    auto offer = [&](size_t head) {
+        if (!meetsQuorum(pts, s, head, quorum)) return;
         PlanetQueue current;
-        PlanetLoc last;
-        if (!outOfOrb(*allOfThem.crbegin(), *allOfThem.cbegin(),  orb)) {
-            auto next = allOfThem.crbegin();
+        for (size_t w = head; w < s.window.size(); ++w) {
+            unsigned i = s.window[w];
+            current.emplace_back(pts.ids[i], s.loc[i]);
+        }
+        groups.insert(current, minQuorum, requireAnchor);
+    };
+
+    auto& w = s.window;
+    w.clear();
+    size_t head = 0;
+    unsigned last;
+    if (!outOfOrb(o[n-1], o[0])) {
+        // Let's see if anything wraps around...
+        unsigned k = n;
+        do {
+            last = o[--k];
+            w.push_back(last);
+        } while (k > 0 && !outOfOrb(o[0], o[k-1]));
+        std::reverse(w.begin(), w.end());
+    } else {
+        last = o[0];
+    }
+    w.push_back(o[0]);
+
+    for (unsigned k = 1; k < n; ++k) {
+        unsigned pl = o[k];
+        if (outOfOrb(pl, last)) {
+            offer(head);
             do {
-                wrapped = true;
-                last = *next;
-                seen = last.planet;
-                current.push_front(last);
-            } while (++next != allOfThem.crend()
-                     && !outOfOrb(*allOfThem.cbegin(), *next, orb));
-        } else {
-            last = *allOfThem.cbegin();
+                if (++head == w.size()) {
+                    last = pl;
+                    break;
+                }
+                last = w[head];
+            } while (outOfOrb(pl, last));
         }
-        current.push_back(*allOfThem.cbegin());
-        for (auto plit = allOfThem.cbegin(); ++plit != allOfThem.cend(); ) {
-            const auto& pl = *plit;
-            //const Planet& plan = getPlanet(pl.planet);
-            if (/* DISABLES CODE */ (false) && wrapped && pl.planet == seen) {
-                break;
+        w.push_back(pl);
+    }
+    offer(head);
+}
+
+// Keeps each harmonic's groups unless a lower harmonic dividing it has
+// a group with the same bodies or more already. Groups are remembered
+// as bitmasks, a 64-bit word of bodies per chart, so testing one
+// against another is a few ANDs. A group with a body whose id won't fit
+// in a word is kept as its PlanetSet instead.
+class joiner {
+    PlanetHarmonics& hx;
+    const HarmonicContext& ctx;
+    const harmonicPoints& pts;
+
+    std::vector<std::vector<quint64>> seen;     // by harmonic
+    std::vector<std::vector<PlanetSet>> wide;   // by harmonic
+    std::vector<quint64> mask;
+    std::vector<bool> over;     // by slot: has a body past the mask
+
+    bool getMask(const PlanetSet& ps)
+    {
+        mask.assign(pts.numSlots, 0);
+        over.assign(pts.numSlots, false);
+        bool fits = true;
+        for (const auto& cpid : ps) {
+            auto s = pts.slot(cpid.fileId());
+            auto pid = cpid.planetId();
+            if (pid >= 0 && pid < 64) {
+                mask[s] |= quint64(1) << pid;
+            } else {
+                over[s] = true;
+                fits = false;
             }
-            if (outOfOrb(pl, last, orb)) {
-                auto next = plit;
-                ++next;
+        }
+        return fits;
+    }
+
+    // as below, for a lower group that's a set
+    static bool covers(const PlanetSet& lower, const PlanetSet& ps)
+    {
+        return std::all_of(ps.begin(), ps.end(),
+                           [&lower](const ChartPlanetId& cpid)
+        {
+            return lower.count(cpid)
+                    || std::none_of(lower.begin(), lower.end(),
+                                    [&cpid](const ChartPlanetId& l)
+            { return l.fileId() == cpid.fileId(); });
+        });
+    }
 
-                if (meetsQuorum(current, needsFiles, quorum)) {
-                    groups.insert(current, minQuorum);
+    bool seenBelow(unsigned h, const PlanetSet& ps) const
+    {
+        const unsigned n = pts.numSlots;
+        for (unsigned lh : ctx.factors[h]) {
+            const auto& masks = seen[lh];
+            for (size_t m = 0; m < masks.size(); m += n) {
+                // a chart the lower group doesn't have any of is no
+                // matter, as with ChartPlanetBitmap::contains()
+                bool contains = true;
+                for (unsigned s = 0; s < n && contains; ++s) {
+                    quint64 lower = masks[m + s];
+                    contains = !lower || (!(mask[s] & ~lower) && !over[s]);
                 }
-                do {
-                    current.pop_front();
-                    if (current.empty()) {
-                        last = pl;
-                        break;
-                    }
-                    last = *current.cbegin();
-                } while (outOfOrb(pl, last, orb));
+                if (contains) return true;
+            }
+            for (const auto& lower : wide[lh]) {
+                if (covers(lower, ps)) return true;
             }
-            current.push_back(pl);
         }
+        return false;
+    }
 
-        if (meetsQuorum(current,needsFiles,quorum)) {
-            groups.insert(current, minQuorum);
-        }
-    };
+public:
+    joiner(PlanetHarmonics& hxIn,
+           const HarmonicContext& context,
+           const harmonicPoints& points) :
+        hx(hxIn), ctx(context), pts(points),
+        seen(context.maxHarmonic + 1), wide(context.maxHarmonic + 1)
+    { }
 
-    std::function<harmonicResult(unsigned)> orbLoop = [&](unsigned h) {
-        PlanetGroups groups;
-        PlanetRange allOfThem;
-        if (doMidpoints) {
-            computePositions(h, allOfThem, true);
-            for (auto l : loop) {
-                std::get<1>(l) /= 10;
-                cluster(groups, l, allOfThem);
+    void operator()(uintMSet& completed, const harmonicResult& res)
+    {
+        unsigned h = res.first;
+        completed.insert(h);
+        bool prime = ctx.primeSieve[h];
+        if (prime) hx[h] = res.second;
+
+        for (const auto& g : res.second) {
+            if (!g.first.containsMidPt()) {
+                bool fits = getMask(g.first);
+                if (!prime && seenBelow(h, g.first)) continue;
+                if (fits) seen[h].insert(seen[h].end(), mask.begin(), mask.end());
+                else wide[h].push_back(g.first);
             }
-            allOfThem.clear();
-        }
-        computePositions(h, allOfThem);
-        for (const auto& l : loop) {
-            cluster(groups, l, allOfThem);
+            if (!prime) hx[h].insert(g);
         }
-        return harmonicResult(h, groups);
-    };
-
-    using namespace QtConcurrent;
+    }
+};
 
-    joiner j(hx, primeSieve);
-    QFuture<uintMSet> f = /*uintSet foo =*/
-        mappedReduced<uintMSet>(seq, orbLoop, j, OrderedReduce);
-    f.waitForFinished();
-}
+} // anonymous-namespace
 
-void
-findHarmonics(const ChartPlanetMap& cpm,
-              PlanetHarmonics& hx)
+HarmonicContext::HarmonicContext() :
+    maxHarmonic(A::maxHarmonic()),
+    primeFactorLimit(A::primeFactorLimit()),
+    minQuorum(harmonicsMinQuorum()),
+    includeMidpoints(A::includeMidpoints()),
+    requireAnchor(A::requireAnchor()),
+    aspectMode(A::aspectMode)
 {
-    bool doMidpoints = includeMidpoints();
     int d = harmonicsMinQuorum() <= harmonicsMaxQuorum() ? 1 : -1;
     unsigned num = fabs(harmonicsMaxQuorum() - harmonicsMinQuorum()) + 1;
     qreal orb = harmonicsMinQOrb()*orbFactor();
@@ -1779,30 +2322,101 @@ findHarmonics(const ChartPlanetMap& cpm,
     qreal od = num < 2 ? 0 : pow(2, (lorbMax - lorbMin) / (num - 1));
     unsigned quorum = unsigned(harmonicsMinQuorum());
     unsigned i = 0;
-    looper loop;
     while (i < num) {
         bool cleanup = (++i == num) && (num > 1) && filterFew();
-        loop.push_back(quorumOrbCleanup(quorum,orb,cleanup));
+        passes.push_back({ quorum, orb, cleanup });
         quorum = unsigned(int(quorum) + d);
         orb *= od;
     }
-    findHarmonics(cpm,hx,loop,doMidpoints);
+    prepare();
+}
+
+void
+HarmonicContext::prepare()
+{
+    const unsigned maxH = maxHarmonic;
+
+    // A prime sieve, and the harmonics to search: 1, the primes up to
+    // the prime factor limit and the non-primes with no prime factor
+    // beyond it.
+    primeSieve.assign(maxH+1,true);
+    std::vector<bool> maxFactor(maxH+1,false);
+    harmonics.assign(1, 1);
+    for (unsigned int i = 2; i <= maxH; ++i) {
+        if (!primeSieve[i]) {
+            if (!maxFactor[i]) harmonics.push_back(i);
+            continue;
+        }
+        bool beyond = i > primeFactorLimit;
+        if (!beyond) harmonics.push_back(i);
+        for (unsigned int j = i+i; j <= maxH; j += i) {
+            primeSieve[j] = false;
+            maxFactor[j] = beyond;
+        }
+    }
+
+    factors.assign(maxH+1, { });
+    for (unsigned f = 1; f <= maxH/2; ++f) {
+        for (unsigned h = f+f; h <= maxH; h += f) {
+            factors[h].push_back(f);
+        }
+    }
+}
+
+void
+findHarmonics(const ChartPlanetMap& cpm,
+              PlanetHarmonics& hx,
+              const HarmonicContext& ctx)
+{
+    harmonicPoints pts(cpm, ctx.aspectMode, ctx.includeMidpoints);
+
+    std::function<harmonicResult(unsigned)> orbLoop = [&](unsigned h) {
+        auto& s = st_harmonicScratch;
+        PlanetGroups groups;
+        if (ctx.includeMidpoints) {
+            harmonicPositions(pts, h, true, s);
+            for (const auto& pass : ctx.passes) {
+                harmonicCluster(pts, s, groups, pass.quorum,
+                                pass.orb / 10, ctx.minQuorum,
+                                ctx.requireAnchor);
+            }
+        }
+        harmonicPositions(pts, h, false, s);
+        for (const auto& pass : ctx.passes) {
+            harmonicCluster(pts, s, groups, pass.quorum,
+                            pass.orb, ctx.minQuorum, ctx.requireAnchor);
+        }
+        return harmonicResult(h, groups);
+    };
+
+    using namespace QtConcurrent;
+
+    joiner j(hx, ctx, pts);
+    QFuture<uintMSet> f = /*uintSet foo =*/
+        mappedReduced<uintMSet>(ctx.harmonics, orbLoop, j, OrderedReduce);
+    f.waitForFinished();
+
     for (auto it = hx.begin(); it != hx.end();) {
         if (it->second.empty()) hx.erase(it++); else ++it;
     }
 }
 
 void
-calculateBaseChartHarmonic(Horoscope& scope)
+findHarmonics(const ChartPlanetMap& cpm,
+              PlanetHarmonics& hx)
+{ findHarmonics(cpm, hx, HarmonicContext()); }
+
+void
+calculateBaseChartHarmonic(Horoscope& scope, aspectModeEnum mode)
 {
     scope.houses = scope.housesOrig;
     scope.planets = scope.planetsOrig;
 
     const InputData& input(scope.inputData);
-    if (scope.harmonic != 1.0 && aspectMode != amcGreatCircle) {
+    if (scope.harmonic != 1.0 && mode != amcGreatCircle) {
         calculateHarmonic(scope.harmonic, scope.houses, scope.planets);
     } else {
-        findPlanetStarConfigs(scope.planets, scope.stars);
+        findPlanetStarConfigs(scope.planets, scope.stars, scope.starIndex);
     }
 
     scope.sun = scope.planets[Planet_Sun];
@@ -1820,7 +2434,7 @@ calculateBaseChartHarmonic(Horoscope& scope)
     for (PlanetId id : scope.planets.keys()) {
         if (id >= Planet_Sun) {
             scope.planets[id].power =
-                calculatePlanetPower(scope.planets[id], scope);
+                calculatePlanetPower(scope.planets[id], scope, mode);
         }
     }
 }
@@ -2030,11 +2644,6 @@ dateTimeFromJulian(double jd)
     return QDateTime(QDate(y,m,d), QTime(hr,min,sec,msec), Qt::UTC);
 }
 
-namespace {
-static bool s_quiet = false;
-thread_local bool st_quiet = s_quiet;
-}
-
 struct calcPos {
     PlanetProfile& poses;
     uintmax_t _iter = 0;
@@ -2045,10 +2654,7 @@ struct calcPos {
     {
         ++_iter;
         auto ret = poses.computePos(jd);
-        if (!st_quiet) {
-            QDateTime dt(dateTimeFromJulian(jd));
-            qDebug() << "calc iter:" << dtToString(dt) << "Ret:" << ret;
-        }
+        A_TRACE(traceDetail, "calc iter: %1 Ret: %2", Trace::jd(jd), ret);
         return ret;
     }
 
@@ -2062,9 +2668,8 @@ struct calcSpd {
     qreal operator()(double jd)
     {
         poses.computePos(jd);
-        if (!st_quiet) {
-            qDebug() << "calc iter:" << dtToString(dateTimeFromJulian(jd)) << "Ret:" << poses.speed();
-        }
+        A_TRACE(traceDetail, "calc iter: %1 Ret: %2",
+                Trace::jd(jd), poses.speed());
         return poses.speed();
     }
 };
@@ -2079,10 +2684,8 @@ struct calcPosSpd {
         auto pos = poses.computePos(jd);
         auto ret = std::make_pair(pos, poses.speed());
 
-        if (!st_quiet) {
-            QDateTime dt(dateTimeFromJulian(jd));
-            qDebug() << "ncalc iter:" << dtToString(dt) << "Ret:" << ret;
-        }
+        A_TRACE(traceDetail, "ncalc iter: %1 Ret: (%2, %3)",
+                Trace::jd(jd), ret.first, ret.second);
 
         return ret;
     }
@@ -2103,8 +2706,7 @@ struct calcSpread {
         auto ret = getSpread(poses);
 #endif
 
-        QDateTime dt(dateTimeFromJulian(jd));
-        qDebug() << "spread iter:" << dtToString(dt) << "Ret:" << ret;
+        A_TRACE(traceDetail, "spread iter: %1 Ret: %2", Trace::jd(jd), ret);
         return ret;
     }
 };
@@ -2134,11 +2736,8 @@ struct calcLoop {
                     double splo,
                     bool cont)
     {
-        qDebug() << "calcLoop: begin" << begin
-                 << "end" << end
-                 << "span" << span
-                 << "flo" << flo
-                 << "splo" << splo;
+        A_TRACE(traceDetail, "calcLoop: begin %1 end %2 span %3 flo %4 splo %5",
+                begin, end, span, flo, splo);
 
         using namespace boost::math::tools;
 
@@ -2150,28 +2749,26 @@ struct calcLoop {
             fhi = cpos(jdc + span);
             sphi = poses.speed();
             if ((done = (fabs(poses.loc) <= tol))) {
-                qDebug() << "  done by span convergence";
+                A_TRACE(traceDetail, "  done by span convergence");
                 jd = jdc+span/2;
                 continue;
             }
             if (span <= tol) {
-                qDebug() << "  zeno's paradox";
+                A_TRACE(traceDetail, "  zeno's paradox");
                 return false;
             }
             if (sgn(flo)==sgn(fhi)) {
-                qDebug() << "same sign"; continue;
+                A_TRACE(traceDetail, "same sign"); continue;
             }
             if (abs(fhi) >= 170. && abs(flo) >= 170.) {
-                qDebug() << "flo and fhi >= 170"; continue;
+                A_TRACE(traceDetail, "flo and fhi >= 170"); continue;
             }
-            qDebug() << "sgn(flo)=" << sgn(flo)
-                     << " sgn(splo)=" << sgn(splo)
-                     << " sgn(fhi)=" << sgn(fhi)
-                     << " sgn(sphi)=" << sgn(sphi);
+            A_TRACE(traceDetail, "sgn(flo)=%1 sgn(splo)=%2 sgn(fhi)=%3 sgn(sphi)=%4",
+                    sgn(flo), sgn(splo), sgn(fhi), sgn(sphi));
             if (sgn(flo)!=sgn(splo) || sgn(fhi)!=-sgn(sphi)) {
 #if 0
                 done = brentZhangStage(cpos, jdc,jdc+span, flo, fhi, jd);
-                if (done) qDebug() << "  done by brent";
+                if (done) A_TRACE(traceDetail, "  done by brent");
 #else
                 double guess = jdc + (fabs(flo)/(fabs(flo)+fabs(fhi)))*span;
                 uintmax_t iter = 20;
@@ -2180,8 +2777,7 @@ struct calcLoop {
                                                 digits, iter);
                     done = fabs(poses[1]->loc - poses[0]->loc) <= tol
                             || span < tol;
-                    if (done)
-                        qDebug() << "  done by newton";
+                    if (done) A_TRACE(traceDetail, "  done by newton");
                 } catch (...) { }
 #endif
             }
@@ -2190,7 +2786,7 @@ struct calcLoop {
                 done = operator()(b, jdc+span, span/4, flo, splo,false);
             }
         }
-        if (!done) qDebug() << "  ran out clock";
+        if (!done) A_TRACE(traceDetail, "  ran out clock");
         return done;
     }
 #endif
@@ -2228,9 +2824,8 @@ struct calcLoop {
                     T lo,
                     bool cont)
     {
-        qDebug() << "calcLoop: begin" << dtToString(dateTimeFromJulian(begin))
-                 << "end" << dtToString(dateTimeFromJulian(end))
-                 << "span" << span;
+        A_TRACE(traceDetail, "calcLoop: begin %1 end %2 span %3",
+                Trace::jd(begin), Trace::jd(end), span);
 
         bool done = false;
         T hi;
@@ -2245,19 +2840,19 @@ struct calcLoop {
                 }
             } else {
                 if ((done = (fabs(poses.loc) <= tol))) {
-                    qDebug() << "  done by span convergence";
+                    A_TRACE(traceDetail, "  done by span convergence");
                     jd = jdc+span/2;
                     continue;
                 }
                 if (span <= tol) {
-                    qDebug() << "  zeno's paradox";
+                    A_TRACE(traceDetail, "  zeno's paradox");
                     return false;
                 }
                 if (signsEqual(lo, hi)) {
-                    qDebug() << "same sign"; continue;
+                    A_TRACE(traceDetail, "same sign"); continue;
                 }
                 if (longDistance(lo, hi)) {
-                    qDebug() << "flo and fhi >= 170"; continue;
+                    A_TRACE(traceDetail, "flo and fhi >= 170"); continue;
                 }
                 //if (sgn(flo)!=sgn(splo) || sgn(fhi)!=-sgn(sphi)) {
                 done = doIterativeCalc(jd, jdc, jdc+span, lo, hi);
@@ -2268,7 +2863,7 @@ struct calcLoop {
                 }
             }
         }
-        if (!done) qDebug() << "  ran out clock";
+        if (!done) A_TRACE(traceDetail, "  ran out clock");
         return done;
     }
 };
@@ -2293,7 +2888,7 @@ calcLoop::doIterativeCalc<qreal>(double& jd,
                                  qreal hi)
 {
     bool done = brentZhangStage(cspd, jlo, jhi, lo, hi, jd);
-    if (done) qDebug() << "  done by brent";
+    if (done) A_TRACE(traceDetail, "  done by brent");
     return done;
 }
 
@@ -2320,14 +2915,13 @@ calcLoop::doIterativeCalc<posSpd>(double& jd,
                            csprd.m, .0000001/*err*/, tol, jd);
             if (csprd.poses.computeSpread(jd) <= harmonicsMinQOrb()) {
                 done = true;
-                qDebug() << "  done by brentGlobalMin";
+                A_TRACE(traceDetail, "  done by brentGlobalMin");
             }
         } else {
             jd = newton_raphson_iterate(ncpos, g, jlo, jhi, digits, iter);
             done = fabs(poses[1]->loc - poses[0]->loc) <= tol
                     || span < tol;
-            if (done)
-                qDebug() << "  done by newton";
+            if (done) A_TRACE(traceDetail, "  done by newton");
         }
         return done;
     } catch (...) {
@@ -2390,10 +2984,11 @@ quotidianSearch(PlanetProfile& poses,
                 double span /*= 1.0*/,
                 bool forceMin)
 {
-    modalize<bool> mum(st_quiet,true);
+    modalize<int> mum(Trace::echoLevel(), A_TRACE_ECHO);
 
     double jd1 = getJulianDate(locale.GMT());
     double jd2 = getJulianDate(endDT);
+    EphemerisCache::Window ecw(jd1 - 1, jd2 + 1);
 
     poses.setForceMinimize(forceMin);
     if (poses.needsFindMinimalSpread()) span *= 2.; else span /= 4.;
@@ -2433,10 +3028,9 @@ quotidianSearch(PlanetProfile& poses,
                         && !ret.isEmpty()
                         && qAbs(dt.secsTo(ret.back())) < 86400)
                 {
-                    auto ugh = qAbs(dt.secsTo(ret.back()));
-                    qDebug() << ugh << "Let's scrunch up"
-                             << dtToString(dt) << "and"
-                             << dtToString(ret.back());
+                    A_TRACE(traceInfo, "%1 Let's scrunch up %2 and %3",
+                            qAbs(dt.secsTo(ret.back())), Trace::jd(jd),
+                            Trace::jd(getJulianDate(ret.back())));
                     // XXX goofy hack to ignore adjacent values
                     auto hi = lo;
                     auto jda = jd - .5;
@@ -2452,7 +3046,8 @@ quotidianSearch(PlanetProfile& poses,
                 }
                 ret << dt;
 
-                qDebug() << "** Finding:" << dtToString(dt);
+                A_TRACE(traceInfo, "** Finding: %1",
+                        Trace::jd(getJulianDate(dt)));
                 looper.calc(jd1, lo);
             }
         } while (jd1 < jd2);
@@ -2478,7 +3073,7 @@ calculateReturnTime(PlanetId id,
                     const InputData& locale,
                     double harmonic)
 {
-    modalize<bool> mum(st_quiet,true);
+    modalize<int> mum(Trace::echoLevel(), A_TRACE_ECHO);
 
     PlanetProfile poses;
     poses.push_back(new NatalLoc(id, native));
@@ -2489,50 +3084,23 @@ calculateReturnTime(PlanetId id,
 
 
 Horoscope
-calculateAll(const InputData& input)
+calculateAll(const InputData& input, aspectModeEnum mode)
 {
     Horoscope scope;
     scope.inputData = input;
     scope.houses = calculateHouses(input);
     scope.zodiac = getZodiac(input.zodiac());
+    EphemerisFrame frame(input, scope.zodiac.id);
 
     for (PlanetId id : getPlanets(true,true)) {
-        if (id == Planet_Asc) {
-            Planet asc = Data::getPlanet(id);
-            asc.eclipticPos.setX(scope.houses.Asc);
-            asc.equatorialPos.setX(scope.houses.RAAC);
-            asc.pvPos = 0;
-            scope.planets[id] = asc;
-        } else if (id == Planet_Desc) {
-            Planet desc = Data::getPlanet(id);
-            desc.eclipticPos.setX(swe_degnorm(180.+scope.houses.Asc));
-            desc.equatorialPos.setX(swe_degnorm(180.+scope.houses.RAAC));
-            desc.pvPos = 180;
-            scope.planets[id] = desc;
-        } else if (id == Planet_MC) {
-            Planet mc = Data::getPlanet(id);
-            mc.eclipticPos.setX(scope.houses.MC);
-            mc.equatorialPos.setX(scope.houses.RAMC);
-            mc.pvPos = 270;
-            scope.planets[id] = mc;
-        } else if (id == Planet_IC) {
-            Planet ic = Data::getPlanet(id);
-            ic.eclipticPos.setX(swe_degnorm(180.+scope.houses.MC));
-            ic.equatorialPos.setX(swe_degnorm(180.+scope.houses.RAMC));
-            ic.pvPos = 90;
-            scope.planets[id] = ic;
-        } else if (id > Planet_Asc && id <= House_12) {
-            Planet hc = Data::getPlanet(id);
-            hc.eclipticPos.setX(scope.houses.cusp[id - Planet_Asc]);
-            hc.equatorialPos.setX(scope.houses.cusp[id - Planet_Asc]); // XXX
-            hc.pvPos = 30 * (id - Planet_Asc);
-            hc.house = id - Planet_Asc;
-            scope.planets[id] = hc;
+        if (isAnglePlanet(id)) {
+            scope.planets[id] = anglePlanet(id, scope.houses);
         } else {
             scope.planets[id] =
                     calculatePlanet(id, input,
                                     scope.houses,
-                                    scope.zodiac);
+                                    scope.zodiac,
+                                    frame);
         }
     }
 
@@ -2540,6 +3108,7 @@ calculateAll(const InputData& input)
         scope.stars[name.toStdString()] =
             calculateStar(name, input, scope.houses, scope.zodiac);
     }
+    scope.starIndex.rebuild(scope.stars);
 
     if (scope.planets.contains(-1)) {
         qDebug() << "Wha?";
@@ -2548,7 +3117,7 @@ calculateAll(const InputData& input)
     scope.housesOrig = scope.houses;
     scope.planetsOrig = scope.planets;
 
-    calculateBaseChartHarmonic(scope);
+    calculateBaseChartHarmonic(scope, mode);
 
     if (scope.planets.contains(-1)) {
         qDebug() << "Wha?";
@@ -2557,6 +3126,51 @@ calculateAll(const InputData& input)
     return scope;
 }
 
+void
+recalculate(Horoscope& scope, ChartParts parts, aspectModeEnum mode)
+{
+    if ((parts & chartPositions) || scope.planetsOrig.isEmpty()) {
+        // nothing survives a new time or zodiac but the harmonic
+        double harmonic = scope.harmonic;
+        scope = HoroscopeCache::calculate(scope.inputData, mode);
+        if (harmonic != scope.harmonic) {
+            scope.harmonic = harmonic;
+            calculateBaseChartHarmonic(scope, mode);
+        }
+        return;
+    }
+
+    const InputData& input(scope.inputData);
+    if (parts & (chartLocation | chartHouses)) {
+        // Ecliptic and equatorial positions stand; houses and what is
+        // placed in them don't, and a new place also means new
+        // horizontal coordinates and angle transits.
+        bool local = parts & chartLocation;
+        Houses houses = calculateHouses(input);
+        std::unique_ptr<EphemerisFrame> frame;  // only a new place needs it
+        if (local) frame.reset(new EphemerisFrame(input, scope.zodiac.id));
+
+        for (auto it = scope.planetsOrig.begin();
+             it != scope.planetsOrig.end(); ++it)
+        {
+            if (isAnglePlanet(it.key())) {
+                it.value() = anglePlanet(it.key(), houses);
+                continue;
+            }
+            if (local) localizePlanet(it.value(), houses, *frame);
+            placePlanet(it.value(), houses, scope.zodiac);
+        }
+
+        for (Star& star : scope.stars) {
+            if (local) localizeStar(star, input, houses);
+            star.house = getHouse(houses, star.eclipticPos.x());
+        }
+        scope.housesOrig = houses;
+    }
+
+    calculateBaseChartHarmonic(scope, mode);
+}
+
 EventOptions::EventOptions(const QVariantMap& map)
 {
     defaultTimespan = map.value("Events/defaultTimespan").toString();
@@ -2642,8 +3256,9 @@ EventOptions::toMap()
 OmnibusFinder::OmnibusFinder(HarmonicEvents& evs,
                              const ADateRange& range,
                              const uintSSet& hset,
-                             const AstroFileList& files) :
-    AspectFinder(evs, range, hset, afcFindStuff)
+                             const AstroFileList& files,
+                             const EventOptions& opts) :
+    AspectFinder(evs, range, hset, afcFindStuff, opts)
 {
     // This ugly jumble intends to generate the appropriate planet listings,
     // and then create the T-T T-N P-P P-N pairings. And the ingresses, etc.
@@ -3002,19 +3617,123 @@ OmnibusFinder::OmnibusFinder(HarmonicEvents& evs,
 #endif
 }
 
-void AspectFinder::prepThread()
-{
+namespace {
+// swed is thread-local in the swe library, so each worker keeps its own
+// ephemeris files open for the life of the thread rather than reopening
+// them around every solve. The session closes when the thread goes away,
+// i.e. when the pool expires or tears down its workers.
+QAtomicInt s_ephemerisOpens;
+QAtomicInt s_ephemerisCloses;
+
+struct ephemerisSession {
+    bool open = false;
+
+    void prep()
+    {
+        if (open) return;
 #if MSDOS
-    char ephePath[] = "swe\\";
+        char ephePath[] = "swe\\";
 #else
-    char ephePath[] = "swe/";
+        char ephePath[] = "swe/";
 #endif
-    swe_set_ephe_path(ephePath);
+        swe_set_ephe_path(ephePath);
+        open = true;
+        ++s_ephemerisOpens;
+    }
+
+    void release()
+    {
+        if (!open) return;
+        swe_close();
+        open = false;
+        ++s_ephemerisCloses;
+    }
+
+    ~ephemerisSession() { release(); }
+};
+
+thread_local ephemerisSession st_ephemeris;
+}
+
+TransitTimeline::TransitTimeline(const InputData& ida,
+                                 const PlanetSet& bodies,
+                                 double jd0, double step, unsigned steps) :
+    _ida(ida),
+    _bodies(bodies.begin(), bodies.end()),
+    _jd0(jd0),
+    _step(step),
+    _steps(steps),
+    _cols(unsigned(_bodies.size())),
+    _loc(size_t(steps) * _cols),
+    _speed(size_t(steps) * _cols)
+{
+    // rows are independent, so fill them in blocks across the pool
+    constexpr unsigned block = 64;
+    std::vector<unsigned> starts;
+    for (unsigned r = 0; r < _steps; r += block) starts.push_back(r);
+
+    QtConcurrent::blockingMap(starts, [this](unsigned r0) {
+        st_ephemeris.prep();
+        for (unsigned r = r0, n = qMin(r0 + block, _steps); r < n; ++r) {
+            double jd = _jd0 + double(r) * _step;
+            for (unsigned c = 0; c < _cols; ++c) {
+                std::tie(_loc[r * _cols + c], _speed[r * _cols + c]) =
+                        PlanetLoc::compute(_bodies[c], _ida, jd);
+            }
+        }
+    });
+}
+
+bool
+TransitTimeline::serves(const InputData& ida) const
+{
+    return &ida == &_ida
+            || (ida.GMT() == _ida.GMT()
+                && ida.location() == _ida.location()
+                && ida.zodiac() == _ida.zodiac()
+                && ida.houseSystem() == _ida.houseSystem());
+}
+
+int
+TransitTimeline::column(const ChartPlanetId& cpid) const
+{
+    auto it = std::find(_bodies.begin(), _bodies.end(), cpid);
+    return it == _bodies.end()? -1 : int(it - _bodies.begin());
+}
+
+int
+TransitTimeline::row(double jd) const
+{
+    if (_step <= 0) return -1;
+    auto k = qRound64((jd - _jd0) / _step);
+    if (k < 0 || k >= qint64(_steps)) return -1;
+    // the search loop steps the same way, so a grid point is exact
+    if (_jd0 + double(k) * _step != jd) return -1;
+    return int(k);
+}
+
+/*static*/
+void AspectFinder::prepThread()
+{
+    st_ephemeris.prep();
 }
 
+/*static*/
 void AspectFinder::releaseThread()
 {
-    swe_close();
+    st_ephemeris.release();
+}
+
+/*static*/
+int AspectFinder::ephemerisOpens()
+{
+    return s_ephemerisOpens;
+}
+
+/*static*/
+int AspectFinder::ephemerisCloses()
+{
+    return s_ephemerisCloses;
 }
 
 
@@ -3028,7 +3747,7 @@ AspectFinder::findStations()
     auto d = start.startOfDay().toUTC();
     auto e = end.startOfDay().toUTC();
 
-    modalize<bool> mum(st_quiet, true);
+    modalize<int> mum(Trace::echoLevel(), A_TRACE_ECHO);
 
     double jd = getJulianDate(d);
     for (auto tp: _alist) (*tp)(jd, 1);   // the horror
@@ -3036,7 +3755,7 @@ AspectFinder::findStations()
     PlanetProfile b = _alist;
 
     auto useRate = 15;  // search every 15 days
-    if (!st_quiet) qDebug() << "sta" << dtToString(d);
+    A_TRACE(traceDetail, "sta %1", Trace::jd(jd));
 
     double pjd = jd;
     int ndays = int(useRate);
@@ -3054,7 +3773,7 @@ AspectFinder::findStations()
         }
 
         jd = getJulianDate(nd);
-        if (!st_quiet) qDebug() << "sta" << dtToString(nd);
+        A_TRACE(traceDetail, "sta %1", Trace::jd(jd));
 
         // compute new positions
         for (auto tp: b) (*tp)(jd, 1);
@@ -3075,18 +3794,13 @@ AspectFinder::findStations()
 
             auto aspd = _alist[i]->speed;
             auto bspd = b[i]->speed;
-            if (!st_quiet) {
-                qDebug() << "  " << _alist[i]->description() << aspd << bspd;
-            }
+            A_TRACE(traceDetail, "  %1 %2 %3", pl->planet, aspd, bspd);
             if (sgn(aspd) == sgn(bspd)) continue;
 
             bool wasRetro = aspd < 0;
-            _evs.emplace_back();
-            auto& ev = _evs.back();
 #if 1
-            tp.start([=, &stations, &ev] {
+            tp.start([=, &stations] {
                 startTask();
-                modalize<bool> mum(st_quiet, true);
 #endif
 
                 auto pj = dynamic_cast<PlanetLoc*>(_alist[i]->clone());
@@ -3102,12 +3816,13 @@ AspectFinder::findStations()
                     auto qdt = dateTimeFromJulian(tjd);
                     auto ploc = dynamic_cast<PlanetLoc*>(pj);
 
-                    auto dt = dtToString(qdt);
                     PlanetRangeBySpeed plr { *ploc };
 
-                    ev = HarmonicEvent(qdt, etcStation, 1, std::move(plr));
+                    _evs.post(HarmonicEvent(qdt, etcStation, 1,
+                                            std::move(plr)));
 
-                    if (!st_quiet) qDebug() << dt << pj->description();
+                    A_TRACE(traceDetail, "%1 %2 %3", Trace::jd(tjd),
+                            ploc->planet, wasRetro? "SD" : "SR");
 
                     if (includeShadowTransits) {
                         // Add shadow-period transit lookup
@@ -3120,8 +3835,8 @@ AspectFinder::findStations()
                         stations.emplace_back(pj);
                     }
                 } else {
-                    qDebug() << "Couldn't find station for"
-                        << _alist[i]->description() << "!";
+                    A_TRACE(traceWarning, "Couldn't find station for %1!",
+                            pl->planet);
                 }
 #if 1
                 endTask();
@@ -3157,6 +3872,7 @@ AspectFinder::findStations()
             active = now;
         }
     }
+    _evs.publish();
 
     qDebug() << "Done with finding stations";
 
@@ -3190,25 +3906,273 @@ operator<<(std::ostream& os, const PlanetClusterMap& pcm)
     return os;
 }
 
-void AspectFinder::findAspectsAndPatterns()
+namespace {
+
+// Batch version of the sign-change test in the pair loop below. It is
+// deliberately conservative: anything within deltaSlop of zero or of
+// the 90-degree cutoff is flagged, and flagged pairs are rechecked with
+// PlanetProfile::computeDelta(), so the vector and scalar paths agree.
+constexpr double deltaSlop = harmonicDeltaSlop;
+
+inline double
+harmonicPos(double v, double h)
 {
-    if (_alist.empty()) return;
-    
-    PlanetSet nats, trans;
-    PlanetProfile b = _alist;
-    bool skipAllNatalOnly = false;
-    if (!showTransitAspectPatterns && showTransitNatalAspectPatterns) {
-        for (auto&& pl : _alist) {
-            auto pla = dynamic_cast<NatalPosition*>(pl);
-            if (!pla || pla->inMotion()) continue;
-            nats.emplace(pla->planet);
-        }
-        skipAllNatalOnly = true;
-    } else if (showTransitAspectPatterns
-               && (!showTransitNatalAspectPatterns
-                   || _ids.size()==1))
-    {
-        for (auto&& pl : _alist) {
+    double x = v*h;
+    return x - 360.*floor(x/360.);
+}
+
+inline double
+wrapDelta(double d)
+{
+    if (d > 180) return d - 360;
+    if (d < -180) return d + 360;
+    return d;
+}
+
+inline unsigned char
+isCandidate(double ad, double bd)
+{
+    double lo = qMin(std::abs(ad), std::abs(bd));
+    double hi = qMax(std::abs(ad), std::abs(bd));
+    return (ad*bd < 0 || lo < deltaSlop) && hi < 90. + deltaSlop;
+}
+
+} // anonymous-namespace
+
+void
+harmonicDeltaCandidatesScalar(unsigned n, unsigned h,
+                              const double* ai, const double* aj,
+                              const double* bi, const double* bj,
+                              unsigned char* cand)
+{
+    const double dh = h;
+    for (unsigned k = 0; k < n; ++k) {
+        double ad = h == 1? aj[k] - ai[k]
+                          : harmonicPos(aj[k], dh) - harmonicPos(ai[k], dh);
+        double bd = h == 1? bj[k] - bi[k]
+                          : harmonicPos(bj[k], dh) - harmonicPos(bi[k], dh);
+        cand[k] = isCandidate(wrapDelta(ad), wrapDelta(bd));
+    }
+}
+
+void
+harmonicDeltaCandidates(unsigned n, unsigned h,
+                        const double* ai, const double* aj,
+                        const double* bi, const double* bj,
+                        unsigned char* cand)
+{
+    unsigned k = 0;
+
+#if defined(__AVX2__)
+    const __m256d vh = _mm256_set1_pd(h);
+    const __m256d v360 = _mm256_set1_pd(360.);
+    const __m256d vinv = _mm256_set1_pd(1./360.);
+    const __m256d v180 = _mm256_set1_pd(180.);
+    const __m256d vm180 = _mm256_set1_pd(-180.);
+    const __m256d v90 = _mm256_set1_pd(90. + deltaSlop);
+    const __m256d vslop = _mm256_set1_pd(deltaSlop);
+    const __m256d vzero = _mm256_setzero_pd();
+    const __m256d vabs = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    auto hpos = [&](__m256d v) {
+        if (h == 1) return v;
+        __m256d x = _mm256_mul_pd(v, vh);
+        __m256d q = _mm256_floor_pd(_mm256_mul_pd(x, vinv));
+        return _mm256_sub_pd(x, _mm256_mul_pd(q, v360));
+    };
+    auto wrap = [&](__m256d d) {
+        d = _mm256_sub_pd(d, _mm256_and_pd(_mm256_cmp_pd(d, v180, _CMP_GT_OQ), v360));
+        return _mm256_add_pd(d, _mm256_and_pd(_mm256_cmp_pd(d, vm180, _CMP_LT_OQ), v360));
+    };
+    for (; k + 4 <= n; k += 4) {
+        __m256d ad = wrap(_mm256_sub_pd(hpos(_mm256_loadu_pd(aj + k)),
+                                        hpos(_mm256_loadu_pd(ai + k))));
+        __m256d bd = wrap(_mm256_sub_pd(hpos(_mm256_loadu_pd(bj + k)),
+                                        hpos(_mm256_loadu_pd(bi + k))));
+        __m256d aa = _mm256_and_pd(ad, vabs);
+        __m256d ba = _mm256_and_pd(bd, vabs);
+        __m256d flip = _mm256_cmp_pd(_mm256_mul_pd(ad, bd), vzero, _CMP_LT_OQ);
+        __m256d near = _mm256_cmp_pd(_mm256_min_pd(aa, ba), vslop, _CMP_LT_OQ);
+        __m256d inRange = _mm256_cmp_pd(_mm256_max_pd(aa, ba), v90, _CMP_LT_OQ);
+        int m = _mm256_movemask_pd(_mm256_and_pd(_mm256_or_pd(flip, near),
+                                                 inRange));
+        for (unsigned l = 0; l < 4; ++l) cand[k+l] = (m >> l) & 1;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128d vh = _mm_set1_pd(h);
+    const __m128d v360 = _mm_set1_pd(360.);
+    const __m128d vinv = _mm_set1_pd(1./360.);
+    const __m128d v180 = _mm_set1_pd(180.);
+    const __m128d vm180 = _mm_set1_pd(-180.);
+    const __m128d v90 = _mm_set1_pd(90. + deltaSlop);
+    const __m128d vslop = _mm_set1_pd(deltaSlop);
+    const __m128d vzero = _mm_setzero_pd();
+    const __m128d vabs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    auto hpos = [&](__m128d v) {
+        if (h == 1) return v;
+        // positions are non-negative, so truncation is floor
+        __m128d x = _mm_mul_pd(v, vh);
+        __m128d q = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_mul_pd(x, vinv)));
+        return _mm_sub_pd(x, _mm_mul_pd(q, v360));
+    };
+    auto wrap = [&](__m128d d) {
+        d = _mm_sub_pd(d, _mm_and_pd(_mm_cmpgt_pd(d, v180), v360));
+        return _mm_add_pd(d, _mm_and_pd(_mm_cmplt_pd(d, vm180), v360));
+    };
+    for (; k + 2 <= n; k += 2) {
+        __m128d ad = wrap(_mm_sub_pd(hpos(_mm_loadu_pd(aj + k)),
+                                     hpos(_mm_loadu_pd(ai + k))));
+        __m128d bd = wrap(_mm_sub_pd(hpos(_mm_loadu_pd(bj + k)),
+                                     hpos(_mm_loadu_pd(bi + k))));
+        __m128d aa = _mm_and_pd(ad, vabs);
+        __m128d ba = _mm_and_pd(bd, vabs);
+        __m128d flip = _mm_cmplt_pd(_mm_mul_pd(ad, bd), vzero);
+        __m128d near = _mm_cmplt_pd(_mm_min_pd(aa, ba), vslop);
+        __m128d inRange = _mm_cmplt_pd(_mm_max_pd(aa, ba), v90);
+        int m = _mm_movemask_pd(_mm_and_pd(_mm_or_pd(flip, near), inRange));
+        cand[k] = m & 1;
+        cand[k+1] = (m >> 1) & 1;
+    }
+#endif
+
+    if (k < n) {
+        harmonicDeltaCandidatesScalar(n - k, h, ai + k, aj + k,
+                                      bi + k, bj + k, cand + k);
+    }
+}
+
+namespace {
+
+/// flattened endpoints of the search pairs at the previous and current
+/// step, in _staff order (planetsEtc::slot)
+struct pairDeltaBatch {
+    std::vector<unsigned> ii, jj;
+    std::vector<double> ai, aj, bi, bj;
+    std::vector<unsigned char> cand;
+
+    // how fast each pair's delta can close at H1, in degrees per day
+    // (negative if there's no telling), and by pair and harmonic, the
+    // first step at which it could be a candidate again
+    std::vector<double> rate;
+    std::vector<unsigned> wake;
+    unsigned stride = 0;
+
+    void setPairs(searchPairList& staff)
+    {
+        unsigned n = 0;
+        for (auto& pe: staff) pe.slot = n++;
+        ii.resize(n); jj.resize(n);
+        ai.resize(n); aj.resize(n);
+        bi.resize(n); bj.resize(n);
+        cand.assign(n, 0);
+        for (const auto& pe: staff) {
+            ii[pe.slot] = pe.a();
+            jj[pe.slot] = pe.b();
+        }
+    }
+
+    void gather(const FlatProfile& fa, const FlatProfile& fb)
+    {
+        for (unsigned k = 0, n = unsigned(ii.size()); k < n; ++k) {
+            ai[k] = fa.loc[ii[k]]; aj[k] = fa.loc[jj[k]];
+            bi[k] = fb.loc[ii[k]]; bj[k] = fb.loc[jj[k]];
+        }
+    }
+
+    void compute(unsigned h)
+    {
+        harmonicDeltaCandidates(unsigned(ii.size()), h,
+                                ai.data(), aj.data(), bi.data(), bj.data(),
+                                cand.data());
+    }
+
+    void setRates(const FlatProfile& fp, unsigned maxH,
+                  aspectModeEnum mode)
+    {
+        auto bound = [&](unsigned i) -> double {
+            if (!fp.inMotion(i)) return 0;
+            auto s = maxSpeedOf(fp.ids[i], mode);
+            return s? s : -1;
+        };
+        unsigned n = unsigned(ii.size());
+        rate.resize(n);
+        for (unsigned k = 0; k < n; ++k) {
+            auto si = bound(ii[k]), sj = bound(jj[k]);
+            rate[k] = (si < 0 || sj < 0)? -1 : si + sj;
+        }
+        stride = maxH + 1;
+        wake.assign(n * stride, 0);
+    }
+
+    bool asleep(unsigned slot, unsigned h, unsigned k) const
+    { return k < wake[slot * stride + h]; }
+
+    /// The pair in slot was d apart at harmonic h at the end of step k:
+    /// let it sleep through the steps it can't possibly get within
+    /// deltaSlop of contact, with a little to spare.
+    void schedule(unsigned slot, unsigned h, unsigned k,
+                  double d, double step)
+    {
+        if (rate[slot] < 0) return;
+        auto& w = wake[slot * stride + h];
+        if (rate[slot] == 0) {
+            w = std::numeric_limits<unsigned>::max();
+            return;
+        }
+        double m = .9 * (std::abs(d) - deltaSlop) / (rate[slot] * h * step);
+        if (m >= 1) w = k + 1 + unsigned(qMin(m, 1e9));
+    }
+};
+
+}
+
+double AspectFinder::searchStep() const
+{
+    // same tests as findAspectsAndPatterns() below
+    bool anyNats = false;
+    if (!showTransitAspectPatterns && showTransitNatalAspectPatterns) {
+        for (auto&& pl : _alist) {
+            auto pla = dynamic_cast<NatalPosition*>(pl);
+            if (pla && !pla->inMotion()) { anyNats = true; break; }
+        }
+    }
+    bool showPatterns = showTransitAspectPatterns || anyNats;
+
+    auto hs = *_hsets.crbegin();
+    unsigned maxH =
+            (hs.empty()
+             || (!showTransitAspectPatterns
+                 && !showTransitsToTransits
+                 && (!anyNats && !showTransitsToNatalPlanets)))
+            ? 1
+            : *hs.crbegin();
+
+    auto useRate = 1 / double(maxH); // XXX
+    if (showPatterns) {
+        useRate *= patternsSpreadOrb/16.;
+    }
+    int ndays = int(useRate);
+    int nsecs = (useRate - double(ndays)) * 24.*60.*60.;
+    return ndays + nsecs / (24.*60.*60.);
+}
+
+void AspectFinder::findAspectsAndPatterns()
+{
+    if (_alist.empty()) return;
+    
+    PlanetSet nats, trans;
+    bool skipAllNatalOnly = false;
+    if (!showTransitAspectPatterns && showTransitNatalAspectPatterns) {
+        for (auto&& pl : _alist) {
+            auto pla = dynamic_cast<NatalPosition*>(pl);
+            if (!pla || pla->inMotion()) continue;
+            nats.emplace(pla->planet);
+        }
+        skipAllNatalOnly = true;
+    } else if (showTransitAspectPatterns
+               && (!showTransitNatalAspectPatterns
+                   || _ids.size()==1))
+    {
+        for (auto&& pl : _alist) {
             auto pla = dynamic_cast<TransitPosition*>(pl);
             if (!pla || !pla->inMotion()) continue;
             trans.emplace(pla->planet);
@@ -3230,7 +4194,7 @@ void AspectFinder::findAspectsAndPatterns()
 
     auto itc = QThread::idealThreadCount();
     qDebug() << "Ideal thread count" << itc;
-    tp.setMaxThreadCount(itc);
+    tp.setMaxThreadCount(_solverThreads > 0? _solverThreads : itc);
 
     const auto& start = _range.first;
     auto end = _range.second;
@@ -3242,6 +4206,12 @@ void AspectFinder::findAspectsAndPatterns()
     double ejd = getJulianDate(e);
     for (auto tp: _alist) (*tp)(jd, 1);   // the horror
 
+    // the stepping below works on flat copies: fa is the previous step,
+    // fb the current one
+    FlatProfile fa(_alist);
+    fa.useTimeline(_timeline);
+    FlatProfile::View sv;
+
     auto hs = *_hsets.crbegin();
     unsigned maxH =
             (hs.empty()
@@ -3251,7 +4221,7 @@ void AspectFinder::findAspectsAndPatterns()
             ? 1
             : *hs.crbegin();
 
-    modalize<bool> mum(st_quiet, true);
+    modalize<int> mum(Trace::echoLevel(), A_TRACE_ECHO);
 
     // a simplistic predicate for determining whether to prune the
     // planet pair list as the harmonics go up. We want to limit
@@ -3262,8 +4232,7 @@ void AspectFinder::findAspectsAndPatterns()
     // preview aspects for those stations, this could prune the list.
     // (Or maybe it's better to have a loop engine that various
     // disciplines could be applied to.)
-    unsigned int h { };
-    auto keep = [&](unsigned i, bool derived=false) {
+    auto keep = [&](unsigned h, unsigned i, bool derived=false) {
         if (derived) {
             if (auto p = dynamic_cast<PlanetLoc*>(_alist[i])) {
                 if (p->planet.isMidpt()) {
@@ -3274,16 +4243,11 @@ void AspectFinder::findAspectsAndPatterns()
         return keepLooking(h, i);
     };
 
-    HarmonicPlanetDateRangeMap inOrb;
+    HarmonicPairDateRangeMap inOrb;
     HarmonicPlanetDateRangesMap proximityLog;
     
     HarmonicPlanetClusters starts;
-    auto useRate = 1 / double(maxH); // XXX
-    if (showPatterns) {
-        useRate *= patternsSpreadOrb/16.;
-    }
-    int ndays = int(useRate);
-    int nsecs = (useRate - double(ndays)) * 24.*60.*60.;
+    double step = searchStep();
 
     if (showPatterns || includeTransitRange) {
         HarmonicPlanetClusters work;
@@ -3294,7 +4258,7 @@ void AspectFinder::findAspectsAndPatterns()
             doomed = std::unique_ptr<PlanetProfile>(_alist.profile(trans, stuff));
             useProf = doomed.get();
         }
-        HarmonicPlanetDateRangeMap tinOrb;
+        HarmonicPairDateRangeMap tinOrb;
         for (unsigned h = 1; h <= maxH; ++h) {
             bool unsel = hs.count(h)==0;
             if (unsel /*&& !_filterLowerUnselectedHarmonics*/) continue;
@@ -3323,21 +4287,14 @@ void AspectFinder::findAspectsAndPatterns()
                 bool good = bi->aspectable() || bj->aspectable();
                 std::tie(bd, bsp) =
                         PlanetProfile::computeDelta(bi, bj, h);
-                if (!st_quiet)
-                qDebug() << QString("H%1 %2 at %3 with orb %4")
-                            .arg(h)
-                            .arg(PlanetSet({bi->planet,bj->planet}).names().join('='))
-                            .arg(dtToString(d)).arg(bd)
-                            .toStdString().c_str();
+                A_TRACE(traceDetail, "H%1 %2=%3 at %4 with orb %5",
+                        h, bi->planet, bj->planet, Trace::jd(jd), bd);
                 if (good && std::abs(bd) <= planetPairOrb) {
-                    HarmonicPlanetSet hij { h, { bi->planet, bj->planet }};
+                    HarmonicPair hij(h, bi->planet, bj->planet);
                     tinOrb[hij] = {jd, 0};
-                    //if (!s_quiet)
-                    qDebug() << QString("Found H%1 inital start of %2 at %3 with orb %4")
-                                .arg(h)
-                                .arg(hij.second.names().join("="))
-                                .arg(dtToString(d)).arg(bd)
-                                .toStdString().c_str();
+                    A_TRACE(traceInfo,
+                            "Found H%1 inital start of %2 at %3 with orb %4",
+                            h, hij.planets(), Trace::jd(jd), bd);
                     stuff.erase(it++);
                     continue;
                 }
@@ -3345,7 +4302,7 @@ void AspectFinder::findAspectsAndPatterns()
             }
         }
 
-        auto nd = d;
+        double njd = jd;
         while (!work.empty() || !tinOrb.empty()) {
             QCoreApplication::processEvents();
 
@@ -3355,7 +4312,7 @@ void AspectFinder::findAspectsAndPatterns()
                 continue;
             }
 
-            nd = nd.addDays(-ndays).addSecs(-nsecs);
+            njd -= step;
             PlanetSet ws;
             for (const auto& hpso: work) {
                 for (const auto& pso: hpso.second) {
@@ -3363,38 +4320,28 @@ void AspectFinder::findAspectsAndPatterns()
                 }
             }
             for (const auto& hijr: tinOrb) {
-                ws.insert(hijr.first.second.begin(),
-                          hijr.first.second.end());
+                ws.insert(hijr.first.a);
+                ws.insert(hijr.first.b);
             }
 
-            auto wp = _alist.profile(ws);   // subset of planets
-            auto pjd = getJulianDate(nd);
-            (*wp)(pjd); // XXX compute once
+            auto wp = fa.subset(ws);    // subset of planets
+            auto pjd = njd;
+            wp.computeAt(pjd);
 
             for (auto hit = tinOrb.begin(); hit != tinOrb.end(); ) {
                 const auto& hps = hit->first;
-                const auto& ps = hps.second;
-                auto hwp = wp->profile(ps);
-                auto orb = computeSpread(hps.first, *hwp);
-                delete hwp;
+                auto ps = hps.planets();
+                wp.view(ps, sv);
+                auto orb = computeSpread(hps.h, sv);
                 if (std::abs(orb) > planetPairOrb) {
                     inOrb[hps] = hit->second;
-                    //if (!s_quiet)
-                    qDebug() << QString("Found H%1 start of %2 at %3 with orb %4")
-                                .arg(hps.first)
-                                .arg(ps.names().join("="))
-                                .arg(dtToString(nd))
-                                .arg(orb)
-                                .toStdString().c_str();
+                    A_TRACE(traceInfo, "Found H%1 start of %2 at %3 with orb %4",
+                            hps.h, ps, Trace::jd(pjd), orb);
                     tinOrb.erase(hit++);
                 } else {
-                    if (!st_quiet)
-                    qDebug() << QString("Still looking for H%1 start"
-                                        " of %2 at %3 with orb %4")
-                                .arg(hps.first)
-                                .arg(ps.names().join("="))
-                                .arg(dtToString(nd)).arg(orb)
-                                .toStdString().c_str();
+                    A_TRACE(traceDetail,
+                            "Still looking for H%1 start of %2 at %3 with orb %4",
+                            hps.h, ps, Trace::jd(pjd), orb);
                     hit->second.first = pjd;    // update range start
                     ++hit;
                 }
@@ -3406,17 +4353,13 @@ void AspectFinder::findAspectsAndPatterns()
                 for (auto spit = pso.begin(); spit != pso.end(); ) {
                     const auto& ps = spit->first;
                     auto orbWas = spit->second;
-                    auto hwp = wp->profile(ps);
-                    auto orb = computeSpread(h,*hwp);
-                    delete hwp;
+                    wp.view(ps, sv);
+                    auto orb = computeSpread(h, sv);
                     if (orb > patternsSpreadOrb) {
                         starts[h].emplace(ps,ClusterOrbWhen(orb,pjd));
-                        qDebug() << QString("Found H%1 prior start of %2 "
-                                            "with %3 spread at %4")
-                                    .arg(h).arg(ps.names().join("="))
-                                    .arg(orbWas)
-                                    .arg(dtToString(nd))
-                                    .toStdString().c_str();
+                        A_TRACE(traceInfo, "Found H%1 prior start of %2 "
+                                "with %3 spread at %4",
+                                h, ps, orbWas.orb, Trace::jd(pjd));
                         pso.erase(spit++);
                     } else {
                         if (orb < spit->second.orb) {
@@ -3428,633 +4371,723 @@ void AspectFinder::findAspectsAndPatterns()
                 if (pso.empty()) work.erase(hit++);
                 else ++hit;
             }
-            delete wp;
         }
     }
     if (_state == cancelRequestedState) return;
 
-    double pjd = jd;
-    double ljd = jd;
-    auto nd = d.addDays(ndays).addSecs(nsecs);
-    while (d < e || !starts.empty() || !inOrb.empty()) {
-        QCoreApplication::processEvents();
+    // The walk is cut into chunks of the date range, swept side by side,
+    // each with its own pattern starts, pairs in orb and ranges. A chunk
+    // goes on past its end collecting strays, as the last one always
+    // did past ejd, so whatever is open at a boundary gets seen through
+    // by the chunk it started in. What a chunk picks up on its first
+    // step may well be that same thing, so closing it is put off until
+    // the chunks are stitched back together, after the sweep.
+    struct deferredSearch {
+        unsigned h;
+        PlanetSet ps;
+        std::function<void()> job;
+    };
+    struct sweepChunk {
+        unsigned k0 = 0;
+        double from = 0, to = 0;    ///< julian days of the chunk's steps
+        HarmonicPlanetClusters starts;
+        HarmonicPairDateRangeMap inOrb;
+        HarmonicPlanetDateRangesMap proximityLog;
+
+        std::set<HarmonicPlanetSet> openPatterns;   ///< open at the end
+        std::unordered_set<HarmonicPair, HarmonicPairHash> openPairs;
+        std::vector<deferredSearch> patterns;       ///< inherited closings,
+                                                    ///< never in the first
+        std::vector<std::pair<HarmonicPair, JDateRange>> ranges;
+    };
 
-        if (_state == cancelRequestedState) break;
-        if (_state == pauseRequestedState) {
-            QThread::usleep(100000);
-            continue;
+    // keep() by body: the first harmonic not worth looking at any more
+    std::vector<unsigned> keepBelow(_alist.size(), maxH + 1);
+    for (unsigned i = 0; i < keepBelow.size(); ++i) {
+        for (unsigned h = 1; h <= maxH; ++h) {
+            if (!keep(h, i)) { keepBelow[i] = h; break; }
         }
+    }
 
-        jd = getJulianDate(nd);
-        if (jd - ljd >= 5) {
-            emit progress((ljd - bjd) / (ejd - bjd));
-            ljd = jd;
-            QCoreApplication::processEvents();
-            if (_state == cancelRequestedState) break;
-            if (_state == pauseRequestedState) continue;
-        }
+    // the pair slots are numbered once, here, for all the chunks
+    pairDeltaBatch pairs;
+    pairs.setPairs(_staff);
+    pairs.setRates(fa, maxH, _aspectMode);
 
-        std::unique_ptr<PlanetProfile> useProf;
-        bool collectingStrays = (d >= e);
-        if (collectingStrays) {
-            PlanetSet ws;
-            for (const auto& hpso: starts) {
-                for (const auto& pso: hpso.second) {
-                    ws.insert(pso.first.begin(),pso.first.end());
-                }
-            }
-            for (const auto& hijr: inOrb) {
-                ws.insert(hijr.first.second.begin(),
-                          hijr.first.second.end());
-            }
-            if (ws.empty()) break;  // all done
-            if (ws.size() != b.size()) {
-                qDebug() << "Pruning profile to" << ws.names();
-                auto wp = b.profile(ws);
-                wp->swap(b);
-                delete wp;
-            }
-        }
+    QAtomicInt swept;
+    auto sweep = [&](sweepChunk& c, FlatProfile fa) {
+        prepThread();
+        modalize<int> mum(Trace::echoLevel(), A_TRACE_ECHO);
 
-        for (auto tp: b) (*tp)(jd, 1);
-        if (!st_quiet) qDebug() << "stuff" << dtToString(nd);
+        auto& starts = c.starts;
+        auto& inOrb = c.inOrb;
+        auto logRange = [&](const HarmonicPair& hps,
+                            const JDateRange& r)
+        {
+            if (c.k0 > 0 && r.first == c.from) c.ranges.emplace_back(hps, r);
+            else c.proximityLog[hps.toSet()].emplace(r, 0);
+        };
 
-        if (!collectingStrays && !trans.empty()) {
-            useProf = std::unique_ptr<PlanetProfile>(b.profile(trans));
-        }
+        if (c.k0 > 0) fa.computeAt(c.from);
+        FlatProfile fb(fa);
+        FlatProfile::View pv, sv;
+        pairDeltaBatch pdb(pairs);
 
-        // Do all the things HERE
+        std::vector<ClusterRing> rings;
+        for (unsigned h = 0; h <= maxH; ++h) rings.emplace_back(h);
 
-        if (showPatterns) {
-        // 1. Patterns
-        for (h = maxH; h >= 1; --h) {
-            bool unsel = hs.count(h)==0;
-            if (unsel /*&& !_filterLowerUnselectedHarmonics*/) continue;
+        unsigned h;
+        double jd;
+        double pjd = c.from;
+        unsigned k = c.k0;  // steps taken; jd stays on the bjd + k*step grid
+        bool boundary = true;
+        while (pjd < c.to || !starts.empty() || !inOrb.empty()) {
+            if (_state == cancelRequestedState) break;
+            if (_state == pauseRequestedState) {
+                QThread::usleep(100000);
+                continue;
+            }
+
+            jd = bjd + double(k + 1) * step;
+
+            bool collectingStrays = (pjd >= c.to);
             if (collectingStrays) {
-                bool any = false;
-                auto hit = starts.find(h);
-                if (hit != starts.end()) {
-                    if (hit->second.empty()) starts.erase(hit);
-                    else any = true;
+                PlanetSet ws;
+                for (const auto& hpso: starts) {
+                    for (const auto& pso: hpso.second) {
+                        ws.insert(pso.first.begin(),pso.first.end());
+                        if (boundary) c.openPatterns.emplace(hpso.first,
+                                                             pso.first);
+                    }
+                }
+                for (const auto& hijr: inOrb) {
+                    ws.insert(hijr.first.a);
+                    ws.insert(hijr.first.b);
+                    if (boundary) c.openPairs.insert(hijr.first);
+                }
+                boundary = false;
+                if (ws.empty()) break;  // all done
+                if (ws.size() != fb.size()) {
+                    A_TRACE(traceInfo, "Pruning profile to %1", ws);
+                    auto wp = fb.subset(ws);
+                    wp.swap(fb);
                 }
-                if (!any) continue;
-            }
-            PlanetClusterMap hpc;
-            if (!collectingStrays) {
-                PlanetProfile* prof = &b;
-                if (useProf.get()) prof = useProf.get();
-                hpc = findClusters(h, *prof,
-                                   patternsQuorum,
-                                   nats, skipAllNatalOnly,
-                                   patternsRestrictMoon,
-                                   patternsSpreadOrb);
             }
 
-            std::list<PlanetClusterMap::iterator> doomed;
-            for (auto sit = starts[h].begin(); sit != starts[h].end(); ) {
-                const auto& ps = sit->first;
-                auto prof = b.profile(ps);
-                auto hpcit = hpc.find(ps);
-                if (hpcit != hpc.end()) {
-                    delete prof;
-                    hpc.erase(hpcit);   // already have a start time
-                    ++sit;
-                    continue;
+            fb.computeAt(jd);
+            A_TRACE(traceDetail, "stuff %1", Trace::jd(jd));
+
+            if (!collectingStrays && !trans.empty()) fb.view(trans, pv);
+            else fb.viewAll(pv);
+
+            // Do all the things HERE
+
+            if (showPatterns) {
+            // 1. Patterns
+            for (h = maxH; h >= 1; --h) {
+                bool unsel = hs.count(h)==0;
+                if (unsel /*&& !_filterLowerUnselectedHarmonics*/) continue;
+                if (collectingStrays) {
+                    bool any = false;
+                    auto hit = starts.find(h);
+                    if (hit != starts.end()) {
+                        if (hit->second.empty()) starts.erase(hit);
+                        else any = true;
+                    }
+                    if (!any) continue;
                 }
-                auto spread = computeSpread(h,*prof);
-                if (spread <= patternsSpreadOrb) {
-                    if (collectingStrays) {
-                        qDebug() << QString("H%1 %2 with %3 spread at %4")
-                                    .arg(h).arg(ps.names().join("="))
-                                    .arg(spread)
-                                    .arg(dtToString(dateTimeFromJulian(jd)))
-                                    .toStdString().c_str();
+                auto& ring = rings[h];
+                if (collectingStrays) {
+                    ring.clear();
+                } else {
+                    ring.update(pv,
+                                patternsQuorum,
+                                nats, skipAllNatalOnly,
+                                patternsRestrictMoon,
+                                patternsSpreadOrb);
+                    for (const auto& ps: ring.left()) {
+                        A_TRACE(traceDetail, "H%1 %2 no longer clustered "
+                                "at %3", h, ps, Trace::jd(jd));
                     }
-                    // still good so keep
-                    delete prof;
-                    ++sit;
-                    continue;
                 }
+                const auto& hpc = ring.clusters();
+
+                std::list<PlanetClusterMap::iterator> doomed;
+                for (auto sit = starts[h].begin(); sit != starts[h].end(); ) {
+                    const auto& ps = sit->first;
+                    if (hpc.count(ps)) {
+                        ++sit;      // already have a start time
+                        continue;
+                    }
+                    fb.view(ps, sv);
+                    auto spread = computeSpread(h, sv);
+                    if (spread <= patternsSpreadOrb) {
+                        if (collectingStrays) {
+                            A_TRACE(traceInfo, "H%1 %2 with %3 spread at %4",
+                                    h, ps, spread, Trace::jd(jd));
+                        }
+                        // still good so keep
+                        ++sit;
+                        continue;
+                    }
 
-                double from = sit->second.when;
-                double to = jd;
+                    double from = sit->second.when;
+                    double to = jd;
+
+                    bool cancel = (from == 0);
+                    if (cancel) {
+                        A_TRACE(traceInfo,
+                                "H%1 %2 was previously hijacked, so skipping",
+                                h, ps);
+                    } else {
+                        A_TRACE(traceInfo, "H%1 %2 from %3 to %4",
+                                h, ps, Trace::jd(from), Trace::jd(jd));
+                    }
+
+                    unsigned useH = h;
+                    if (!cancel && h > 1) {
+                        // look for a pending pattern at a lower harmonic
+                        // because it's likely to be the same pattern but
+                        // now we have a tighter bounds. when we find this,
+                        // we set the start time to 0 to indicate that it
+                        // is no longer active.
+                        unsigned prev = 0;
+                        for (unsigned f: getAllFactors(h)) {
+                            if (f == h) break;
+                            if (prev == f) continue;
+                            auto stit = starts.find(f);
+                            if (stit == starts.end()) continue;
+                            auto& startf = stit->second;
+                            auto lwrit = startf.find(ps);
+                            if (lwrit != startf.end()) {
+                                cancel = true;
+                                A_TRACE(traceInfo,
+                                        "H%1 %2 exists, so skipping H%3",
+                                        f, ps, h);
+                                break;
+                            }
+                            prev = f;
+                        }
+                    }
+                    if (cancel) {
+                        starts[h].erase(sit++);
+                        continue;    // skipped!
+                    }
+
+                    static std::atomic<size_t> s_clearing { 0 };
+                    size_t clearing = ++s_clearing;
+                    A_TRACE(traceInfo, "%1 Launching H%2 search for %3 "
+                            "with %4 spread at %5",
+                            clearing, h, ps, spread, Trace::jd(jd));
+                    doomed.emplace_back(sit++);
+                    //starts[h].erase(sit++);
+
+                    // picked up on the chunk's first step, so maybe the
+                    // chunk before's business; see the stitching below
+                    bool inherited = (c.k0 > 0 && from == c.from);
+
+                    EventType et = ps.heterogeneous()? etcTransitNatalAspectPattern
+                                                     : etcTransitAspectPattern;
+                    auto prof = fb.subset(ps);
+#if 1
+                    auto job = [=] {
+                        startTask();
+#endif
+#if 0 // FIXME
+                        if (prof->size()==2) {
+                            qreal ad, asp, bd, bsp;
+
+                            // check speed
+                            prof->computePos(from,h);
+                            std::tie(ad, asp) = PlanetProfile::computeDelta((*prof)[0], (*prof)[1], h);
+                            prof->computePos(jd,h);
+                            std::tie(bd, bsp) = PlanetProfile::computeDelta((*prof)[0], (*prof)[1], h);
+                            if (sgn(ad) != sgn(bd)) {
+                                auto cps = [prof, h](double jd)
+                                        -> std::pair<qreal,qreal>
+                                {
+                                    auto pos = prof->computePos(jd,h);
+                                    std::pair<qreal,qreal> ret { pos, prof->speed() };
+                                    if (false /*!s_quiet*/) {
+                                        QDateTime dt(dateTimeFromJulian(jd));
+                                        qDebug() << "nri " << dtToString(dt).toLatin1().constData()
+                                                 << "ret:" << ret;
+                                    }
+                                    return ret;
+                                };
+                                uintmax_t iter = 50;
+                                static constexpr int digits =
+                                        std::numeric_limits<double>::digits;
+                                using namespace boost::math::tools;
+                                auto tjd = newton_raphson_iterate(cps,(from+jd)/2,
+                                                                  from,jd,digits,iter);
+                                auto psp = PlanetProfile::computeDelta((*prof)[0],
+                                        (*prof)[1],h);
+                                if (std::abs(psp.first) <= calcLoop::tol) {
+                                    qDebug() << "newton succeeded" << iter;
+                                    auto qdt = dateTimeFromJulian(tjd);
+                                    ev.reset(qdt, psp.first);
+                                    delete prof;
+                                } else {
+                                    qDebug() << "newton failed" << iter
+                                        << prof->description().toLatin1().constData();
+                                }
+                            }
+                        }
+#endif
+                        auto pall = prof.all();
+                        auto csprd = [&pall,h,this](double jd)
+                        {
+                            if (_state == cancelRequestedState) throw int(1);
+                            auto val = computeSpread(h,jd,pall,_ids);
+                            //qDebug() << dtToString(dateTimeFromJulian(jd)) << ps.names() << val;
+                            return val;
+                        };
+                        constexpr auto tol =
+                                double(std::numeric_limits<float>::epsilon());
+
+                        double jd;
+                        double m = 1000;
+                        double a = from;
+                        double b = to;
+                        double res;
+                        unsigned it = 0;
+                        try {
+                        do {
+                            double mid = a/2. + b/2.;
+                            ++it;
+                            res = brentGlobalMin(csprd, a, b, mid,
+                                                 m, .0000001, tol, jd);
+                            if (jd == a || jd == b) {
+                                A_TRACE(traceWarning, "Dubious result %1 %2 for "
+                                        "H%3 %4", res,
+                                        (jd == b)? "jd == to" : "jd == from",
+                                        h, ps);
+                                A_TRACE(traceDetail, "  spread at the middle %1",
+                                        csprd(mid));
+                                if (it > 2) break;
+                                m *= 10;
+                                auto q = (mid - a)/4.;
+                                if (jd == b) a = b - q, b += q;
+                                else b = a + q, a -= q;
+                            } else break;
+                        } while (it < 3);
+
+                        ADateTimeRange range(dateTimeFromJulian(from),
+                                             dateTimeFromJulian(to));
+                        HarmonicEvent ev(range, et, useH, PlanetSet(ps));
+                        ev.reset(dateTimeFromJulian(jd), res);
+                        _evs.post(std::move(ev));
+                        } catch (int) { }
+#if 1
+                        endTask();
+                    };
+                    if (inherited) c.patterns.push_back({ h, ps, job });
+                    else tp.start(job);
+#endif
+                    // TODO keep track of this start and end and then search
 
-                bool cancel = (from == 0);
-                if (cancel) {
-                    qDebug() << QString("H%1").arg(h) << ps.names()
-                             << "was previously hijacked, so skipping";
-                } else {
-                    qDebug() << QString("H%1").arg(h)
-                             << ps.names()
-                             << "from" << dtToString(dateTimeFromJulian(from))
-                             << "to" << dtToString(nd);
                 }
 
-                unsigned useH = h;
-                if (!cancel && h > 1) {
-                    // look for a pending pattern at a lower harmonic
-                    // because it's likely to be the same pattern but
-                    // now we have a tighter bounds. when we find this,
-                    // we set the start time to 0 to indicate that it
-                    // is no longer active.
+                // (before adding anything: that may rehash and invalidate
+                // the doomed iterators)
+                for (const auto& it: doomed) starts[h].erase(it);
+
+                // now add what's in hpc but not yet in starts[h], with the
+                // new date. That's only ever what the ring offers: what
+                // just entered, and what a lower harmonic held back last
+                // time.
+                for (const auto& ps: ring.offers()) {
+                    if (starts[h].count(ps)) continue;
+                    const auto& cl = *hpc.find(ps);
+                    bool add = true;
                     unsigned prev = 0;
                     for (unsigned f: getAllFactors(h)) {
                         if (f == h) break;
                         if (prev == f) continue;
                         auto stit = starts.find(f);
                         if (stit == starts.end()) continue;
-                        auto& startf = stit->second;
+                        const auto& startf = stit->second;
                         auto lwrit = startf.find(ps);
                         if (lwrit != startf.end()) {
-                            cancel = true;
-                            qDebug() << QString("H%1").arg(f)
-                                     << ps.names()
-                                     << "exists, so skipping"
-                                     << QString("H%1").arg(h);
+                            add = false;
                             break;
                         }
-                        prev = f;
+                    }
+                    if (add) {
+                        A_TRACE(traceInfo, "Found H%1 start of %2 "
+                                "with %3 spread at %4",
+                                h, ps, cl.second.orb, Trace::jd(jd));
+                        starts[h].emplace(ps, ClusterOrbWhen(cl.second.orb, pjd));
+                    } else {
+                        ring.decline(ps);
                     }
                 }
-                if (cancel) {
-                    delete prof;
-                    starts[h].erase(sit++);
-                    continue;    // skipped!
-                }
-
-                static size_t clearing = 0; clearing++;
-                qDebug() << clearing << QString("Launching H%1 search for %2 "
-                                    "with %3 spread at %4")
-                            .arg(h).arg(ps.names().join("="))
-                            .arg(spread)
-                            .arg(dtToString(dateTimeFromJulian(jd)))
-                            .toStdString().c_str();
-                doomed.emplace_back(sit++);
-                //starts[h].erase(sit++);
-
-                {
-                QMutexLocker ml(&_evs.mutex);
-                ADateTimeRange range(dateTimeFromJulian(from),
-                                     dateTimeFromJulian(jd));
-                EventType et = ps.heterogeneous()? etcTransitNatalAspectPattern
-                                                 : etcTransitAspectPattern;
-                _evs.emplace_back(range, et, useH, PlanetSet(ps));
+            }
+            } // if includeAspectPatterns
+
+            if (collectingStrays && !inOrb.empty()) {
+                for (auto hit = inOrb.begin(); hit != inOrb.end(); ) {
+                    const auto& hps = hit->first;
+                    fb.view(hps.planets(), sv);
+                    auto orb = computeSpread(hps.h, sv);
+                    if (orb > planetPairOrb) {
+                        hit->second.second = pjd;
+                        logRange(hps, hit->second);
+                        inOrb.erase(hit++);
+                    } else {
+                        ++hit;
+                    }
                 }
-                auto& ev = _evs.back();
-#if 1
-                tp.start([=, &ev] {
-                    startTask();
-#endif
-#if 0 // FIXME
-                    if (prof->size()==2) {
-                        qreal ad, asp, bd, bsp;
-
-                        // check speed
-                        prof->computePos(from,h);
-                        std::tie(ad, asp) = PlanetProfile::computeDelta((*prof)[0], (*prof)[1], h);
-                        prof->computePos(jd,h);
-                        std::tie(bd, bsp) = PlanetProfile::computeDelta((*prof)[0], (*prof)[1], h);
-                        if (sgn(ad) != sgn(bd)) {
-                            auto cps = [prof, h](double jd)
-                                    -> std::pair<qreal,qreal>
+            }
+            if (!collectingStrays && !_staff.empty()) {
+                qreal ad, asp;
+                qreal bd, bsp;
+
+                unsigned i, j;
+
+                auto stuff = _staff;
+                if (includeTransitRange) {
+                    for (h = 1; h <= maxH; ++h) {
+                        for (auto it = stuff.begin(); it != stuff.end(); ) {
+                            bool unsel = hs.count(h)==0;
+                            if ((unsel && !filterLowerUnselectedHarmonics)
+                                    || (_hsets[it->hsid].count(h) == 0))
                             {
-                                auto pos = prof->computePos(jd,h);
-                                std::pair<qreal,qreal> ret { pos, prof->speed() };
-                                if (false /*!s_quiet*/) {
-                                    QDateTime dt(dateTimeFromJulian(jd));
-                                    qDebug() << "nri " << dtToString(dt).toLatin1().constData()
-                                             << "ret:" << ret;
+                                ++it;
+                                continue;
+                            }
+                            std::tie(i,j) = *it;
+                            std::tie(bd, bsp) = fb.delta(i, j, h);
+
+                            auto good = fb.isPlanet(i) && fb.isPlanet(j)
+                                    && (fb.aspectable(i) || fb.aspectable(j));
+
+                            bool isInOrb = false;
+                            if (good) {
+                                HarmonicPair hij(h, fb.ids[i], fb.ids[j]);
+
+                                auto hasit = inOrb.find(hij);
+                                isInOrb = std::abs(bd) <= planetPairOrb;
+                                if (hasit == inOrb.end() && isInOrb) {
+                                    A_TRACE(traceDetail,
+                                            "Found H%1 start of %2 at %3",
+                                            h, hij.planets(), Trace::jd(pjd));
+                                    inOrb[hij] = {pjd, 0};
+                                    isInOrb = true;
+                                } else if (hasit != inOrb.end() && !isInOrb) {
+                                    hasit->second.second = jd;
+                                    if (it->et != etcTransitToStation) {
+                                        logRange(hasit->first, hasit->second);
+                                    }
+                                    A_TRACE(traceDetail,
+                                            "Found H%1 range of %2 at %3 to %4",
+                                            h, hij.planets(),
+                                            Trace::jd(hasit->second.first),
+                                            Trace::jd(pjd));
+                                    inOrb.erase(hasit);
                                 }
-                                return ret;
-                            };
-                            uintmax_t iter = 50;
-                            static constexpr int digits =
-                                    std::numeric_limits<double>::digits;
-                            using namespace boost::math::tools;
-                            auto tjd = newton_raphson_iterate(cps,(from+jd)/2,
-                                                              from,jd,digits,iter);
-                            auto psp = PlanetProfile::computeDelta((*prof)[0],
-                                    (*prof)[1],h);
-                            if (std::abs(psp.first) <= calcLoop::tol) {
-                                qDebug() << "newton succeeded" << iter;
-                                auto qdt = dateTimeFromJulian(tjd);
-                                ev.reset(qdt, psp.first);
-                                delete prof;
-                            } else {
-                                qDebug() << "newton failed" << iter
-                                    << prof->description().toLatin1().constData();
                             }
+                            if (isInOrb) stuff.erase(it++);
+                            else ++it;
                         }
                     }
-#endif
-                    auto csprd = [prof,h,this](double jd)
-                    {
-                        if (_state == cancelRequestedState) throw int(1);
-                        auto val = computeSpread(h,jd,*prof,_ids);
-                        //qDebug() << dtToString(dateTimeFromJulian(jd)) << ps.names() << val;
-                        return val;
-                    };
-                    constexpr auto tol =
-                            double(std::numeric_limits<float>::epsilon());
-
-                    double jd;
-                    double m = 1000;
-                    double a = from;
-                    double b = to;
-                    double res;
-                    unsigned it = 0;
-                    try {
-                    do {
-                        double mid = a/2. + b/2.;
-                        ++it;
-                        res = brentGlobalMin(csprd, a, b, mid,
-                                             m, .0000001, tol, jd);
-                        if (jd == a || jd == b) {
-                            qDebug() << "Dubious result" << res
-                                     << ((jd == b)? "jd == to" : ((jd == a)? "jd == from" : ""))
-                                     << "for" << QString("H%1").arg(h)
-                                     << ps.names()
-                                     << QList<qreal>({csprd(a),csprd(mid),csprd(b)});
-                            if (it > 2) break;
-                            m *= 10;
-                            auto q = (mid - a)/4.;
-                            if (jd == b) a = b - q, b += q;
-                            else b = a + q, a -= q;
-                        } else break;
-                    } while (it < 3);
-
-                    QMutexLocker ml(&_evs.mutex);
-                    auto qdt = dateTimeFromJulian(jd);
-                    ev.reset(qdt, res);
-                    } catch (int) { }
-                    delete prof;
-#if 1
-                    endTask();
-                });
-#endif
-                // TODO keep track of this start and end and then search
 
-            }
-
-            // now hpc should only contain entries that are not in starts[h]
-            // and starts[h] will contain entries that *were* initially in hpc,
-            // so we need to add the remainder of hpc to starts[h] with the
-            // new date.
-            for (const auto& cl: hpc) {
-                bool add = true;
-                unsigned prev = 0;
-                const auto& ps(cl.first);
-                for (unsigned f: getAllFactors(h)) {
-                    if (f == h) break;
-                    if (prev == f) continue;
-                    auto stit = starts.find(f);
-                    if (stit == starts.end()) continue;
-                    const auto& startf = stit->second;
-                    auto lwrit = startf.find(ps);
-                    if (lwrit != startf.end()) {
-                        add = false;
-                        break;
-                    }
+                    stuff = _staff;
                 }
-                if (add) {
-                    qDebug() << QString("Found H%1 start of %2 "
-                                        "with %3 spread at %4")
-                                .arg(h).arg(ps.names().join("="))
-                                .arg(cl.second)
-                                .arg(dtToString(dateTimeFromJulian(jd)))
-                                .toStdString().c_str();
-                    starts[h].emplace(ps, ClusterOrbWhen(cl.second.orb, pjd));
-                }
-            }
-            for (const auto& it: doomed) starts[h].erase(it);
-        }
-        } // if includeAspectPatterns
 
-        if (collectingStrays && !inOrb.empty()) {
-            for (auto hit = inOrb.begin(); hit != inOrb.end(); ) {
-                const auto& hps = hit->first;
-                auto hwp = b.profile(hps.second);
-                auto orb = computeSpread(hps.first/*harmonic*/, *hwp);
-                delete hwp;
-                if (orb > planetPairOrb) {
-                    hit->second.second = pjd;
-                    proximityLog[hps].emplace(hit->second,0);
-                    inOrb.erase(hit++);
-                } else {
-                    ++hit;
-                }
-            }
-        }
-        if (!collectingStrays && !_staff.empty()) {
-            qreal ad, asp;
-            qreal bd, bsp;
+                pdb.gather(fa, fb);
+                for (h = 1; h <= maxH; ++h) {
+                    bool unsel = hs.count(h)==0;
+                    if (unsel && !filterLowerUnselectedHarmonics) continue;
 
-            unsigned i, j;
-            QString wha_;
-            auto what = [&]{
-                if (wha_.isEmpty()) {
-                    wha_ = QString("H%1 %2=%3")
-                        .arg(h)
-                        .arg(_alist[i]->description())
-                        .arg(_alist[j]->description());
-                }
-                return wha_.toStdString();
-            };
+                    pdb.compute(h);
 
-            auto stuff = _staff;
-            if (includeTransitRange) {
-                for (h = 1; h <= maxH; ++h) {
                     for (auto it = stuff.begin(); it != stuff.end(); ) {
-                        bool unsel = hs.count(h)==0;
-                        if ((unsel && !filterLowerUnselectedHarmonics)
-                                || (_hsets[it->hsid].count(h) == 0))
-                        {
-                            ++it;
-                            continue;
-                        }
                         std::tie(i,j) = *it;
-                        std::tie(bd, bsp) =
-                                PlanetProfile::computeDelta(b[i], b[j], h);
-
-                        auto bi = dynamic_cast<PlanetLoc*>(b[i]);
-                        auto bj = dynamic_cast<PlanetLoc*>(b[j]);
-                        auto good = bi && bj
-                                && (bi->aspectable() || bj->aspectable());
-
-                        bool isInOrb = false;
-                        if (good) {
-                            HarmonicPlanetSet hij
-                            { h, { bi->planet, bj->planet }};
-                            HarmonicPlanetSet hji { h, { bj->planet, bi->planet }};
-
-                            auto hasit = inOrb.find(hij);
-                            isInOrb = std::abs(bd) <= planetPairOrb;
-                            if (false) //if (isInOrb)
-                            qDebug() << QString("Found H%1 orb %2 of %3 at %4")
-                                        .arg(h).arg(std::abs(bd))
-                                        .arg(hij.second.names().join("="))
-                                        .arg(dtToString(d))
-                                        .toStdString().c_str();
-                            if (hasit == inOrb.end() && isInOrb) {
-                                if (!st_quiet)
-                                qDebug() << QString("Found H%1 start of %2 at %3")
-                                            .arg(h)
-                                            .arg(hij.second.names().join("="))
-                                            .arg(dtToString(d))
-                                            .toStdString().c_str();
-                                inOrb[hij] = {pjd, 0};
-                                isInOrb = true;
-                            } else if (hasit != inOrb.end() && !isInOrb) {
-                                hasit->second.second = jd;
-                                if (it->et != etcTransitToStation) {
-                                    proximityLog[hasit->first]
-                                            .emplace(hasit->second,0);
-                                }
-                                if (!st_quiet)
-                                qDebug() << QString("Found H%1 range of %2 at %3 to %4")
-                                            .arg(h)
-                                            .arg(hij.second.names().join("="))
-                                            .arg(dtToString(dateTimeFromJulian(hasit->second.first)))
-                                            .arg(dtToString(d))
-                                            .toStdString().c_str();
-                                inOrb.erase(hasit);
-                            }
+                        bool cand = pdb.cand[it->slot];
+                        auto et = it->et;
+                        auto hsid = it->hsid;
+                        const auto& hs = _hsets[hsid];
+                        auto ha = hs.lower_bound(h);
+                        if (ha == hs.end()) {
+                            //A_TRACE(traceDetail, "Snipping H%1 %2=%3 because "
+                            //        "no further harmonics", h, fa.ids[i], fa.ids[j]);
+                            stuff.erase(it++); continue;
+                        } else if (*ha != h) {
+                            //A_TRACE(traceDetail, "Skipping H%1 %2=%3 because "
+                            //        "not selecting h", h, fa.ids[i], fa.ids[j]);
+                            ++it; continue;
                         }
-                        if (isInOrb) stuff.erase(it++);
-                        else ++it;
-                    }
-                }
 
-                stuff = _staff;
-            }
+                        if (fa.kind[j] == FlatProfile::flatKnown
+                                && std::abs(fa.knownJD[j]-jd) > windowOf(fa.ids[j]))
+                        {
+                            ++it; continue;
+                        }
 
-            for (h = 1; h <= maxH; ++h) {
-                bool unsel = hs.count(h)==0;
-                if (unsel && !filterLowerUnselectedHarmonics) continue;
-
-                for (auto it = stuff.begin(); it != stuff.end(); ) {
-                    wha_.clear();
-                    std::tie(i,j) = *it;
-                    auto et = it->et;
-                    auto hsid = it->hsid;
-                    const auto& hs = _hsets[hsid];
-                    auto ha = hs.lower_bound(h);
-                    if (ha == hs.end()) {
-                        //qDebug() << "Snipping" << what().c_str()
-                        //         << "because no further harmonics";
-                        stuff.erase(it++); continue;
-                    } else if (*ha != h) {
-                        //qDebug() << "Skipping" << what().c_str()
-                        //         << "because not selecting h" << h;
-                        ++it; continue;
-                    }
+                        // no contact possible before the pair wakes up
+                        if (pdb.asleep(it->slot, h, k)) {
+                            if (h >= keepBelow[i] || h >= keepBelow[j]) {
+                                stuff.erase(it++);
+                            } else {
+                                ++it;
+                            }
+                            continue;
+                        }
 
-                    if (auto known = dynamic_cast<KnownPosition*>(_alist[j])) {
-                        if (std::abs(known->julianDate()-jd) > windowOf(known)) {
-                            ++it; continue;
+                        qreal ispd = qAbs(fa.speed[i]/2. + fb.speed[i]/2.);
+                        qreal jspd = qAbs(fa.speed[j]/2. + fb.speed[j]/2.);
+                        if (ispd > jspd) {
+                            std::swap(i,j);
+                            std::swap(ispd,jspd);
                         }
-                    }
-                    qreal ispd = qAbs(_alist[i]->speed/2. + b[i]->speed/2.);
-                    qreal jspd = qAbs(_alist[j]->speed/2. + b[j]->speed/2.);
-                    if (ispd > jspd) {
-                        std::swap(i,j);
-                        std::swap(ispd,jspd);
-                    }
 
-                    std::tie(ad, asp) = 
-                            PlanetProfile::computeDelta(_alist[i],_alist[j],h);
-                    std::tie(bd, bsp) = 
-                            PlanetProfile::computeDelta(b[i], b[j], h);
-                    if (sgn(ad)==sgn(bd) || (abs(ad)>=90. || abs(bd)>=90.)) {
-                        if (!keep(i) || !keep(j)) {
-                            stuff.erase(it++);
-                        } else {
-                            ++it;
+                        if (cand) {
+                            std::tie(ad, asp) = fa.delta(i, j, h);
+                            std::tie(bd, bsp) = fb.delta(i, j, h);
+                        }
+                        if (!cand
+                                || sgn(ad)==sgn(bd)
+                                || (abs(ad)>=90. || abs(bd)>=90.))
+                        {
+                            pdb.schedule(it->slot, h, k,
+                                         cand? bd : fb.delta(i, j, h).first,
+                                         step);
+                            if (h >= keepBelow[i] || h >= keepBelow[j]) {
+                                stuff.erase(it++);
+                            } else {
+                                ++it;
+                            }
+                            continue;
                         }
-                        continue;
-                    }
 
 #if 1
-                    auto pi = dynamic_cast<PlanetLoc*>(_alist[i]);
-                    if (pi && pi->allowAspects > PlanetLoc::aspOnlyConj) {
-                        qreal spd = _alist[j]->speed/2. + b[j]->speed/2.;
-                        if (pi->allowAspects !=
-                                ((spd<0)? PlanetLoc::aspOnlyRetro
-                                 : PlanetLoc::aspOnlyDirect))
+                        if (fa.isPlanet(i)
+                                && fa.allow[i] > PlanetLoc::aspOnlyConj)
                         {
-                            qDebug() << "skipping wrong-way" << what().c_str();
-                            stuff.erase(it++);
-                            continue;
+                            qreal spd = fa.speed[j]/2. + fb.speed[j]/2.;
+                            if (fa.allow[i] !=
+                                    ((spd<0)? PlanetLoc::aspOnlyRetro
+                                     : PlanetLoc::aspOnlyDirect))
+                            {
+                                A_TRACE(traceInfo, "skipping wrong-way H%1 %2=%3",
+                                        h, fa.ids[i], fa.ids[j]);
+                                stuff.erase(it++);
+                                continue;
+                            }
                         }
-                    }
 #endif
 
-                    if (!st_quiet) {
-                        QDateTime pdt(dateTimeFromJulian(pjd));
-                        QDateTime dt(dateTimeFromJulian(jd));
-                        qDebug() << what().c_str()
-                                 << dtToString(pdt) << "delta" << ad << asp << "vs"
-                             << dtToString(dt) << "delta" << bd << bsp;
-                    }
-                    auto which = what();
-
-                    // At this point, we figure there's _alist transit.
-                    // If the harmonic is not on our list, let's clip the
-                    // stuff list so that it doesn't get recomputed at _alist
-                    // higher-order harmonic. This handles the case where
-                    // conjunction would show up on any higher harmonic
-                    // as an aspect at that harmonic.
-                    stuff.erase(it++);
-                    if (unsel) { continue; }
-
-                    bool useBZS = (_alist[i]->inMotion() && ispd < .00001)
-                            || (_alist[j]->inMotion() && jspd < .00001);
-                    {
-                        QMutexLocker ml(&_evs.mutex);
-                        _evs.emplace_back();
-                    }
-                    auto& ev = _evs.back();
+                        A_TRACE(traceDetail, "H%1 %2=%3 %4 delta %5 vs %6 delta %7",
+                                h, fa.ids[i], fa.ids[j],
+                                Trace::jd(pjd), ad, Trace::jd(jd), bd);
+                        auto ipid = fa.ids[i], jpid = fa.ids[j];
+
+                        // At this point, we figure there's _alist transit.
+                        // If the harmonic is not on our list, let's clip the
+                        // stuff list so that it doesn't get recomputed at _alist
+                        // higher-order harmonic. This handles the case where
+                        // conjunction would show up on any higher harmonic
+                        // as an aspect at that harmonic.
+                        stuff.erase(it++);
+                        if (unsel) { continue; }
+
+                        bool useBZS = (_alist[i]->inMotion() && ispd < .00001)
+                                || (_alist[j]->inMotion() && jspd < .00001);
 #if 1
-                    bool bQuiet = mum;
-                    tp.start([=, &ev] {
-                        startTask();
-                        modalize<bool> mum(st_quiet, bQuiet);
+                        tp.start([=] {
+                            startTask();
 #endif
-                        PlanetProfile poses { _alist[i]->clone(), _alist[j]->clone() };
-
-                        // for slow planetary motion we need to use BrentZhangStage.
-                        // XXX replace magic number: might plausibly instead be
-                        // _alist certain percentage of the default speed.
-                        double tjd {};
-                        uintmax_t iter;
-                        bool bzhs = false;
-                        bool done = false;
-                        if (!useBZS) {
-                            try {
-                                auto cps = [&poses, &which, h, this](double jd)
-                                -> std::pair<qreal,qreal>
-                                {
-                                    if (_state == cancelRequestedState) throw int(1);
-                                    auto pos = poses.computePos(jd,h);
-                                    std::pair<qreal,qreal> ret { pos, poses.speed() };
-                                    if (!st_quiet) {
-                                        QDateTime dt(dateTimeFromJulian(jd));
-                                        qDebug() << "nri " << (which + ":").c_str()
-                                                 << dtToString(dt)
-                                                 << "ret:" << ret;
+                            PlanetProfile poses { _alist[i]->clone(), _alist[j]->clone() };
+
+                            // for slow planetary motion we need to use BrentZhangStage.
+                            // XXX replace magic number: might plausibly instead be
+                            // _alist certain percentage of the default speed.
+                            double tjd {};
+                            uintmax_t iter;
+                            bool bzhs = false;
+                            bool done = false;
+                            if (!useBZS) {
+                                try {
+                                    auto cps = [&poses, &ipid, &jpid, h, this](double jd)
+                                    -> std::pair<qreal,qreal>
+                                    {
+                                        if (_state == cancelRequestedState) throw int(1);
+                                        auto pos = poses.computePos(jd,h);
+                                        std::pair<qreal,qreal> ret { pos, poses.speed() };
+                                        A_TRACE(traceDetail,
+                                                "nri H%1 %2=%3: %4 ret: (%5, %6)",
+                                                h, ipid, jpid, Trace::jd(jd),
+                                                ret.first, ret.second);
+                                        return ret;
+                                    };
+                                    iter = 50;  // TODO !? need to diagnose when we hit this
+                                    static constexpr int digits =
+                                            std::numeric_limits<double>::digits;
+
+                                    using namespace boost::math::tools;
+                                    double guess;
+                                    if (_alist[i]->inMotion() && _alist[j]->inMotion()) {
+                                        guess = pjd + (fabs(ad)/(fabs(ad)+fabs(bd)));
+                                    } else {
+                                        guess = pjd + .5;
+                                    }
+                                    try {
+                                    tjd = newton_raphson_iterate(cps,
+                                                                 guess, pjd, jd,
+                                                                 digits, iter);
+                                    } catch (int) {
+                                        endTask();
+                                        return;
                                     }
-                                    return ret;
-                                };
-                                iter = 50;  // TODO !? need to diagnose when we hit this
-                                static constexpr int digits =
-                                        std::numeric_limits<double>::digits;
 
-                                using namespace boost::math::tools;
-                                double guess;
-                                if (_alist[i]->inMotion() && _alist[j]->inMotion()) {
-                                    guess = pjd + (fabs(ad)/(fabs(ad)+fabs(bd)));
-                                } else {
-                                    guess = pjd + .5;
+                                    auto psp = PlanetProfile::computeDelta(poses[0],poses[1],h);
+                                    if (std::abs(psp.first) <= calcLoop::tol) {
+                                        // check for actual hit per tolerance?
+                                        done = true;
+                                    } else {
+                                        done = false;
+                                    }
+                                } catch (...) {
+                                    done = false;
+                                }
+                                if (!done) {
+                                    A_TRACE(traceDetail, "Failed %1 H%2 %3=%4 after "
+                                            "%5 iteration(s) newton_raphson",
+                                            Trace::jd(pjd), h, ipid, jpid, iter);
+                                    A_TRACE(traceDetail, "speed %1 %2 respectively",
+                                            ispd, jspd);
                                 }
+                            }
+                            if (!done) {
+                                bzhs = true;
+                                unsigned count = 0;
+                                auto cp = [&poses, &count, &ipid, &jpid,
+                                        h, this](double jd)
+                                {
+                                    if (_state == cancelRequestedState) throw int(1);
+                                    ++count;
+                                    auto pos = poses.computePos(jd, h);
+                                    A_TRACE(traceDetail, "bzhs H%1 %2=%3: %4 ret: %5",
+                                            h, ipid, jpid, Trace::jd(jd), pos);
+                                    return pos;
+                                };
                                 try {
-                                tjd = newton_raphson_iterate(cps,
-                                                             guess, pjd, jd,
-                                                             digits, iter);
+                                done = brentZhangStage(cp, pjd, jd, ad, bd, tjd);
                                 } catch (int) {
                                     endTask();
                                     return;
                                 }
 
+                                iter = count;
                                 auto psp = PlanetProfile::computeDelta(poses[0],poses[1],h);
                                 if (std::abs(psp.first) <= calcLoop::tol) {
                                     // check for actual hit per tolerance?
                                     done = true;
-                                } else {
-                                    done = false;
-                                }
-                            } catch (...) {
-                                done = false;
-                            }
-                            if (!done && !st_quiet) {
-                                qDebug() << "Failed"
-                                << d.date().toString()
-                                << which.c_str()
-                                << "after" << iter
-                                << "iteration(s) newton_raphson";
-                                qDebug() << "speed" << ispd << jspd << "respectively";
-                            }
-                        }
-                        if (!done) {
-                            bzhs = true;
-                            unsigned count = 0;
-                            auto cp = [&poses, &count, &which,
-                                    h, this](double jd)
-                            {
-                                if (_state == cancelRequestedState) throw int(1);
-                                ++count;
-                                auto pos = poses.computePos(jd, h);
-                                if (!st_quiet) {
-                                    QDateTime dt(dateTimeFromJulian(jd));
-                                    qDebug() << "bzhs " << (which + ":").c_str()
-                                             << dtToString(dt)
-                                             << "ret:" << pos;
+                                } else {
+                                    done = false;
                                 }
-                                return pos;
-                            };
-                            try {
-                            done = brentZhangStage(cp, pjd, jd, ad, bd, tjd);
-                            } catch (int) {
-                                endTask();
-                                return;
                             }
-
-                            iter = count;
-                            auto psp = PlanetProfile::computeDelta(poses[0],poses[1],h);
-                            if (std::abs(psp.first) <= calcLoop::tol) {
-                                // check for actual hit per tolerance?
-                                done = true;
+                            if (!done) {
+                                A_TRACE(traceWarning, "Failed %1 H%2 %3=%4 after "
+                                        "%5 iteration(s) brentStageZhang",
+                                        Trace::jd(pjd), h, ipid, jpid, iter);
                             } else {
-                                done = false;
+                                // Pack up event
+                                auto qdt = dateTimeFromJulian(tjd);
+                                auto p1loc = dynamic_cast<PlanetLoc*>(poses[0]);
+                                auto p2loc = dynamic_cast<PlanetLoc*>(poses[1]);
+                                PlanetRangeBySpeed plr { *p1loc, *p2loc };
+
+                                auto ch = static_cast<unsigned char>(h);
+                                _evs.post(HarmonicEvent(qdt, et, ch,
+                                                        std::move(plr)));
+
+                                A_TRACE(traceInfo, "%1 H%2 %3=%4 with %5 iteration(s)"
+                                        " %6", Trace::jd(tjd), h, ipid, jpid, iter,
+                                        bzhs? "brentZhangStage" : "newton_raphson");
                             }
-                        }
-                        if (!done /*&& !s_quiet*/) {
-                            qDebug() << "Failed"
-                                << d.date().toString()
-                                << which.c_str()
-                                << "after" << iter
-                                << "iteration(s) brentStageZhang";
-                        } else {
-                            // Pack up event
-                            auto qdt = dateTimeFromJulian(tjd);
-                            auto p1loc = dynamic_cast<PlanetLoc*>(poses[0]);
-                            auto p2loc = dynamic_cast<PlanetLoc*>(poses[1]);
-                            PlanetRangeBySpeed plr { *p1loc, *p2loc };
-
-                            QMutexLocker ml(&_evs.mutex);
-                            auto ch = static_cast<unsigned char>(h);
-                            ev = HarmonicEvent(qdt, et, ch, std::move(plr));
-
-                            //if (!s_quiet)
-                                qDebug() << dtToString(qdt).toLocal8Bit().constData()
-                                         << which.c_str()
-                                         << "with" << iter
-                                         << "iteration(s)"
-                                     << (bzhs? "brentZhangStage" : "newton_raphson");
-                        }
 
 #if 1
-                        endTask();
-                    });
+                            endTask();
+                        });
 #endif
+                    }
                 }
+            } // if includeTransits
+
+            pjd = jd;
+            ++k;
+            if (!collectingStrays) {
+                ++swept;
+                fa.swap(fb);
             }
-        } // if includeTransits
+        }
+    };
 
-        d = nd;
-        nd = d.addDays(ndays).addSecs(nsecs);
-        //nd = d.addDays(_rate);
-        pjd = jd;
-        if (!collectingStrays) _alist.swap(b);
+    // much shorter and the strays past each boundary cost more than the
+    // chunk saves
+    constexpr double minChunkDays = 30;
+
+    unsigned steps = unsigned(ceil((ejd - bjd) / step));
+    unsigned numChunks =
+            qBound(1u, unsigned((ejd - bjd) / minChunkDays),
+                   unsigned(_sweepThreads > 0? _sweepThreads
+                                              : tp.maxThreadCount()));
+    numChunks = qMin(numChunks, qMax(steps, 1u));
+
+    std::vector<sweepChunk> chunks(numChunks);
+    for (unsigned n = 0; n < numChunks; ++n) {
+        auto& c = chunks[n];
+        c.k0 = steps * n / numChunks;
+        c.from = bjd + double(c.k0) * step;
+        c.to = (n + 1 == numChunks)
+                ? ejd : bjd + double(steps * (n + 1) / numChunks) * step;
+    }
+    chunks[0].starts.swap(starts);
+    chunks[0].inOrb.swap(inOrb);
+    A_TRACE(traceInfo, "Sweeping %1 step(s) in %2 chunk(s)",
+            steps, numChunks);
+
+    // the chunks share the solvers' pool, ahead of the searches they
+    // queue up there, so the two don't oversubscribe the cores
+    QSemaphore chunksDone;
+    for (unsigned n = 0; n < numChunks; ++n) {
+        tp.start([&, n] {
+            sweep(chunks[n], fa);
+            chunksDone.release();
+        });
+    }
+    while (!chunksDone.tryAcquire(int(numChunks), 100)) {
+        QCoreApplication::processEvents();
+        _evs.publish();
+        emit progress(double(int(swept)) / double(qMax(steps, 1u)));
+    }
+
+    // stitch: a closing put off by a chunk stands unless the chunk
+    // before it still had the same thing open at the boundary, in which
+    // case that one saw it through from its real start
+    for (unsigned n = 0; n < numChunks; ++n) {
+        auto& c = chunks[n];
+        for (auto& d: c.patterns) {
+            if (n > 0 && chunks[n-1].openPatterns.count({ d.h, d.ps })) {
+                continue;
+            }
+            if (_state != cancelRequestedState) tp.start(d.job);
+        }
+        for (const auto& r: c.ranges) {
+            if (n > 0 && chunks[n-1].openPairs.count(r.first)) continue;
+            c.proximityLog[r.first.toSet()].emplace(r.second, 0);
+        }
+        for (auto& pl: c.proximityLog) {
+            proximityLog[pl.first].insert(pl.second.begin(),
+                                          pl.second.end());
+        }
+        for (auto& hpc: c.starts) {
+            starts[hpc.first].insert(hpc.second.begin(), hpc.second.end());
+        }
+        inOrb.insert(c.inOrb.begin(), c.inOrb.end());
     }
 
     qDebug() << inOrb.size() << "pending pairs";
@@ -4069,7 +5102,7 @@ void AspectFinder::findAspectsAndPatterns()
         auto lit = proximityLog.find(hps);
         if (lit == proximityLog.end()) return;
 
-        if (prep) prepThread();
+        if (prep) prepThread();     // stays open for the worker's lifetime
         auto& ranges = lit->second;
         auto jd = getJulianDate(e.dateTime());
         auto it = ranges.upper_bound({jd,jd});
@@ -4083,11 +5116,11 @@ void AspectFinder::findAspectsAndPatterns()
             }
             ++rit;
         }
-        if (prep) releaseThread();
     };
 
     {
     // get those planet pairs framed
+    _evs.publish();
     QMutexLocker ml(&_evs.mutex);   // lock for swoosh through paired events
     for (auto& ev: _evs) {
         if (ev.eventType() != etcTransitToStation) {
@@ -4096,35 +5129,21 @@ void AspectFinder::findAspectsAndPatterns()
     }
     }
 
-    //if (!s_quiet)
-    {
-        bool any = false;
+    if (traceInfo <= A_TRACE_LEVEL) {
     for (const auto& pl: proximityLog) {
-        QStringList sl;
         for (const auto& r: pl.second) {
             if (r.second) continue;
-            sl << QString("[%1 - %2]")
-                  .arg(dtToString(dateTimeFromJulian(r.first.first)),
-                       dtToString(dateTimeFromJulian(r.first.second)));
+            A_TRACE(traceInfo, "No precise hit for H%1 %2 in [%3 - %4]",
+                    pl.first.first, pl.first.second,
+                    Trace::jd(r.first.first), Trace::jd(r.first.second));
         }
-        if (sl.empty()) continue;
-        if (!any) qDebug() << "Ranges with no precise hits:";
-        any = true;
-        qDebug() << QString("H%1 %2: %3").arg(pl.first.first)
-                    .arg(pl.first.second.names().join("="))
-                    .arg(sl.join(",\n  "))
-                    .toStdString().c_str();
     }
 
     for (const auto& hpc : starts) {
         for (const auto& pso: hpc.second) {
             if (pso.second.when == qreal()) continue;
-            qDebug() << QString("Pending pattern H%1 %2 started at %3")
-                        .arg(hpc.first)
-                        .arg(pso.first.names().join("="))
-                        .arg(dtToString(dateTimeFromJulian(pso.second.when)))
-                        .toStdString().c_str();
-
+            A_TRACE(traceInfo, "Pending pattern H%1 %2 started at %3",
+                    hpc.first, pso.first, Trace::jd(pso.second.when));
         }
     }
     }
@@ -4143,10 +5162,12 @@ void AspectFinder::findAspectsAndPatterns()
             qDebug() << now << "activity/ies";
             active = now;
         }
+        if (_evs.publish()) emit progress(1.);
     }
     utp.reset();    // release thread pool
 
     // now get remaining
+    _evs.publish();
     QMutexLocker ml(&_evs.mutex);   // lock for swoosh through paired events
     auto fut = QtConcurrent::map(_evs, frameJob);
     fut.waitForFinished();
@@ -4173,16 +5194,226 @@ void AspectFinder::run()
 }
 #endif
 
+void AspectFinder::search()
+{
+    _state = runningState;
+    if (showStations) findStations();
+    if (_state != cancelRequestedState) findAspectsAndPatterns();
+    _state = idleState;
+}
+
 void AspectFinder::findStuff()
 {
+    int opens = ephemerisOpens();
+    prepThread();
+
+    // fit the transit bodies once over the whole run, with a little slop
+    // for solves and stations that reach past either end
+    EphemerisCache::Window ecw(getJulianDate(_range.first.startOfDay()
+                                             .toUTC()) - 2,
+                               getJulianDate(_range.second.startOfDay()
+                                             .toUTC()) + 4);
+
+    search();
+
+    qDebug() << "Exiting finder thread;"
+             << ephemerisOpens() - opens << "ephemeris session(s) opened";
+
+    releaseThread();
+
+    thread()->exit();
+}
+
+namespace {
+
+/// A few workers, each with its own deque of task numbers. A worker
+/// takes from the back of its own deque and, once that runs dry, steals
+/// from the front of the others', so one slow chart doesn't leave the
+/// rest of the pool idle behind it.
+class stealingPool {
+public:
+    explicit stealingPool(unsigned workers) : _queues(qMax(workers, 1u)) { }
+
+    unsigned workers() const { return unsigned(_queues.size()); }
+
+    /// deal a task out; only before start()
+    void push(unsigned task)
+    {
+        auto& q = _queues[_next++ % _queues.size()];
+        QMutexLocker ml(&q.mutex);
+        q.tasks.push_back(task);
+    }
+
+    bool take(unsigned w, unsigned& task)
+    {
+        {
+            auto& q = _queues[w];
+            QMutexLocker ml(&q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned v = 1, n = workers(); v < n; ++v) {
+            auto& q = _queues[(w + v) % n];
+            QMutexLocker ml(&q.mutex);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.front();
+            q.tasks.pop_front();
+            A_TRACE(traceDetail, "Worker %1 stole task %2", w, task);
+            return true;
+        }
+        return false;
+    }
+
+    /// one runnable per worker on tp, each calling f(task) until
+    /// there's nothing left to take or steal
+    template <typename F>
+    void start(QThreadPool& tp, F f)
+    {
+        for (unsigned w = 0, n = workers(); w < n; ++w) {
+            tp.start([this, w, f] {
+                unsigned task;
+                while (take(w, task)) f(task);
+            });
+        }
+    }
+
+private:
+    struct queue {
+        QMutex mutex;
+        std::deque<unsigned> tasks;
+    };
+    std::vector<queue> _queues;
+    unsigned _next = 0;
+};
+
+}
+
+MultiChartFinder::MultiChartFinder(HarmonicEvents& evs,
+                                   const ADateRange& range,
+                                   const uintSSet& hset,
+                                   const AstroFileList& charts,
+                                   AstroFile* transits) :
+    AspectFinder(evs, range, hset, afcFindStuff),
+    _transits(transits->horoscope().inputData)
+{
+    // each chart search leaves out what only concerns the transits...
+    EventOptions perChart(*this);
+    perChart.showTransitsToTransits = false;
+    perChart.showTransitAspectPatterns = false;
+    perChart.showStations = false;
+    perChart.showIngresses = false;
+
+    for (auto f : charts) {
+        _events.emplace_back(new HarmonicEvents);
+        _finders.emplace_back(new OmnibusFinder(*_events.back(), range, hset,
+                                                { f, transits }, perChart));
+    }
+
+    // ...which is searched just once. It goes alongside the first chart
+    // so the transits get the same file id as in the chart searches.
+    if (!charts.isEmpty()
+            && (showTransitsToTransits || showTransitAspectPatterns
+                || showStations || showIngresses))
+    {
+        EventOptions transOnly(*this);
+        transOnly.showTransitsToNatalPlanets = false;
+        transOnly.showTransitNatalAspectPatterns = false;
+        transOnly.showTransitsToHouseCusps = false;
+        transOnly.showTransitsToNatalAngles = false;
+        transOnly.showReturns = false;
+        transOnly.showProgressionsToProgressions = false;
+        transOnly.showProgressionsToNatal = false;
+        _finders.emplace_back(new OmnibusFinder(_evs, range, hset,
+                                                { charts.first(), transits },
+                                                transOnly));
+    }
+}
+
+MultiChartFinder::~MultiChartFinder()
+{ }
+
+void MultiChartFinder::findStuff()
+{
+    int opens = ephemerisOpens();
     prepThread();
 
+    auto end = _range.second;
+    if (_range.first == end) end = end.addDays(1);
+    double bjd = getJulianDate(_range.first.startOfDay().toUTC());
+    double ejd = getJulianDate(end.startOfDay().toUTC());
+    EphemerisCache::Window ecw(bjd - 2, ejd + 4);
+
     _state = runningState;
-    if (showStations) findStations();
-    if (_state != cancelRequestedState) findAspectsAndPatterns();
+
+    // transits are file 1 in every search, see the constructor
+    PlanetSet bodies;
+    for (auto pid : getPlanets(includeAsteroids, includeCentaurs)) {
+        bodies.emplace(1, pid, Planet_None);
+    }
+
+    // one timeline per distinct step; the chart searches all share one
+    for (auto& f : _finders) {
+        double step = f->searchStep();
+        if (step <= 0) continue;
+        auto& tl = _timelines[step];
+        if (!tl) {
+            // a couple of days' slop for patterns and pairs still in orb
+            auto steps = unsigned((ejd + 2 - bjd) / step) + 1;
+            tl.reset(new TransitTimeline(_transits, bodies,
+                                         bjd, step, steps));
+            A_TRACE(traceInfo, "Stepped %1 transit bodies %2 times "
+                    "at %3 day(s)", bodies.size(), steps, step);
+        }
+        f->setTimeline(tl.get());
+        f->setSolverThreads(1);     // the pool is busy with the charts
+        f->setSweepThreads(1);
+    }
+
+    QThreadPool tp;
+    stealingPool pool(unsigned(QThread::idealThreadCount()));
+    tp.setMaxThreadCount(int(pool.workers()));
+    for (unsigned t = 0, n = unsigned(_finders.size()); t < n; ++t) {
+        pool.push(t);
+    }
+
+    QAtomicInt done;
+    pool.start(tp, [this, &done](unsigned t) {
+        while (_state == pauseRequestedState) QThread::usleep(100000);
+        if (_state != cancelRequestedState) {
+            startTask();
+            _finders[t]->search();
+            endTask();
+            if (int(t) < charts()) emit chartFinished(int(t));
+        }
+        ++done;
+    });
+
+    int was = 0;
+    while (!tp.waitForDone(100)) {
+        QCoreApplication::processEvents();
+        for (auto& f : _finders) {
+            if (_state == cancelRequestedState) f->cancel();
+            else if (_state == pauseRequestedState) f->pause();
+            else f->resume();
+        }
+        int now(done);
+        if (now != was) {
+            emit progress(double(now) / double(_finders.size()));
+            was = now;
+        }
+    }
+
+    for (auto& evs : _events) evs->publish();
+    _evs.publish();
+    emit progress(1.);
     _state = idleState;
 
-    qDebug() << "Exiting finder thread";
+    qDebug() << "Exiting multi-chart finder thread;"
+             << _events.size() << "chart(s),"
+             << ephemerisOpens() - opens << "ephemeris session(s) opened";
 
     releaseThread();
 
@@ -4405,55 +5636,111 @@ struct lessPosit {
 };
 typedef std::set<position,lessPosit> positions;
 
+// houses, IC and Desc only count at H1, and the south node only at the
+// odd harmonics, where it isn't the north node all over again
 inline
 bool
-containsAny(const positions& pos, const PlanetSet& of)
+clusterable(unsigned h, PlanetId pid)
 {
-    return std::any_of(pos.begin(), pos.end(),
-                       [&](const position& p) {
-        return of.contains(p.second);
-    });
+    if (h>1 && ((pid >= Houses_Start
+                && pid < Houses_End)
+                || (pid == Planet_IC
+                     || pid == Planet_Desc)))
+    { return false; }
+    return !(h%2==0 && pid == Planet_SouthNode);
 }
 
 inline
 bool
-containsAnyTrans(const positions& pos)
-{
-    return std::any_of(pos.begin(), pos.end(),
-                       [&](const position& p) {
-        return p.second.fileId() == 1
-                && p.second.planetId() != Planet_Moon;
-    });
-}
+isTransiting(const ChartPlanetId& cpid)
+{ return cpid.fileId() == 1 && cpid.planetId() != Planet_Moon; }
 
-inline
+template <typename It>
 PlanetSet
-getSet(const positions& pos)
+getSet(It b, It e)
 {
     PlanetSet ret;
-    for (const auto& p: pos) {
-        ret.emplace(p.second);
+    for (auto it = b; it != e; ++it) {
+        ret.emplace(it->second);
     }
     return ret;
 }
 
 inline
-unsigned
-sizeWithoutTransitingMoon(const positions& grp,
-                          bool moonIn1)
-{
-    unsigned ret = 0;
-    for (const auto& p: grp) {
-        auto pid = p.second.planetId();
-        if ((pid != Planet_Moon
-             && pid != Planet_NorthNode
-             && pid != Planet_SouthNode)
-                || (p.second.fileId() != (moonIn1? 1 : 0)))
-            ++ret;
-    }
-    return ret;
+bool
+countsTowardQuorum(const ChartPlanetId& cpid, bool moonIn1)
+{
+    auto pid = cpid.planetId();
+    return (pid != Planet_Moon
+            && pid != Planet_NorthNode
+            && pid != Planet_SouthNode)
+            || (cpid.fileId() != (moonIn1? 1 : 0));
 }
 
+// Interns candidate groups made of plain planets from the first two
+// charts as a pair of bitmasks, one per chart. findClusters sees most
+// groups from several windows, and this way builds a PlanetSet for each
+// only once. Open addressing, linear probing.
+class groupMasks {
+public:
+    typedef std::pair<quint64, quint64> key;
+
+    static bool fits(const ChartPlanetId& cpid)
+    {
+        return !cpid.isMidpt()
+                && (cpid.fileId() == 0 || cpid.fileId() == 1)
+                && cpid.planetId() >= 0 && cpid.planetId() < 64;
+    }
+
+    static void add(key& k, const ChartPlanetId& cpid)
+    {
+        auto bit = quint64(1) << cpid.planetId();
+        if (cpid.fileId() == 0) k.first |= bit;
+        else k.second |= bit;
+    }
+
+    static size_t hash(const key& k)
+    {
+        quint64 h = k.first * 0x9e3779b97f4a7c15ull
+                ^ k.second * 0xc2b2ae3d27d4eb4full;
+        return size_t(h ^ (h >> 29));
+    }
+
+    /// index of k, in order of first appearance
+    unsigned intern(const key& k)
+    {
+        if ((_keys.size() + 1) * 2 > _slots.size()) grow();
+        auto i = find(k);
+        if (_slots[i] < 0) {
+            _slots[i] = int(_keys.size());
+            _keys.push_back(k);
+        }
+        return unsigned(_slots[i]);
+    }
+
+    const key& at(unsigned n) const { return _keys[n]; }
+
+private:
+    std::vector<key> _keys;
+    std::vector<int> _slots;    // -1 when empty
+
+    size_t find(const key& k) const
+    {
+        size_t mask = _slots.size() - 1;
+        for (size_t i = hash(k) & mask; ; i = (i + 1) & mask) {
+            if (_slots[i] < 0 || _keys[_slots[i]] == k) return i;
+        }
+    }
+
+    void grow()
+    {
+        _slots.assign(_slots.empty()? 64 : _slots.size() * 2, -1);
+        for (unsigned n = 0; n < _keys.size(); ++n) {
+            _slots[find(_keys[n])] = int(n);
+        }
+    }
+};
+
 std::ostream &
 operator<<(std::ostream& os, const position& pos)
 {
@@ -4484,27 +5771,22 @@ toString(const T& t)
 
 }
 
-PlanetClusterMap
-findClusters(const positions& posits,
-             unsigned quorum,
-             const PlanetSet& need /*={}*/,
-             bool skipAllNatalOnly = false,
-             bool restrictMoon = true,
-             qreal maxOrb = 8.)
+// pv in lessPosit order. Hands each group found to f as the run [i,j)
+// of pv, with its mask if it fits one. Those that fit come once each,
+// at their latest sighting; the others as often as they're seen.
+template <typename Found>
+void
+eachCluster(const std::vector<position>& pv,
+            unsigned quorum,
+            const PlanetSet& need,
+            bool skipAllNatalOnly,
+            bool restrictMoon,
+            qreal maxOrb,
+            Found f)
 {
-#if 0
-    qDebug() << "quorum" << quorum
-             << "need" << need.names()
-             << "skipAllNatalOnly" << skipAllNatalOnly
-             << "restrictMoon" << restrictMoon
-             << "maxOrb" << maxOrb;
-    qDebug() << toString(posits).c_str();
-    //if (posits.size() > 1) qDebug() << "\n";
-#endif
-
     bool moonIn1 = skipAllNatalOnly;
     if (restrictMoon && !skipAllNatalOnly) {
-        for (const auto& pos: posits) {
+        for (const auto& pos: pv) {
             const auto& cpid = pos.second;
             if (cpid.fileId()==1 && cpid.planetId()==Planet_Moon) {
                 moonIn1 = true;
@@ -4512,33 +5794,90 @@ findClusters(const positions& posits,
             }
         }
     }
-    PlanetClusterMap ret;
-    for (auto it = posits.begin(); it != posits.end(); ++it) {
-        positions grp;
-        auto maybeAddGroup = [&] {
-            if ((restrictMoon? sizeWithoutTransitingMoon(grp,moonIn1)
-                 : grp.size()) < quorum)
+    // each group is a run [i,j) of pv, grown one position at a time
+    struct sighting { unsigned i, j; qreal spread; };
+    std::vector<sighting> seen;     // latest, by interned group
+    groupMasks masks;
+    for (unsigned i = 0; i < pv.size(); ++i) {
+        unsigned count = 0;
+        bool anyNeed = false, anyTrans = false, fits = true;
+        groupMasks::key key { 0, 0 };
+        auto maybeAddGroup = [&](unsigned j) {
+            if (j == i || count < quorum) return;
+
+            if ((!need.empty() && !anyNeed)
+                    || (skipAllNatalOnly && !anyTrans))
             { return; }
 
-            if ((!need.empty() && !containsAny(grp,need))
-                    || (skipAllNatalOnly && !containsAnyTrans(grp)))
-            { return; }
-
-            auto spread = angle(grp.begin()->first, grp.rbegin()->first);
-            ret[getSet(grp)] = spread;
+            auto spread = angle(pv[i].first, pv[j-1].first);
+            if (!fits) {
+                f(nullptr, i, j, spread);
+                return;
+            }
+            auto n = masks.intern(key);
+            if (n == seen.size()) seen.push_back({ i, j, spread });
+            else seen[n] = { i, j, spread };
         };
 
-        auto e = posits.lower_bound(position(it->first + maxOrb,
-                                             ChartPlanetId()));
-        for (auto jit = it; jit != e; ++jit) {
-            maybeAddGroup();
-            grp.emplace(*jit);
+        auto e = unsigned(std::lower_bound(pv.begin() + i, pv.end(),
+                                           position(pv[i].first + maxOrb,
+                                                    ChartPlanetId()),
+                                           lessPosit()) - pv.begin());
+        for (unsigned j = i; j < e; ++j) {
+            maybeAddGroup(j);
+            const auto& cpid = pv[j].second;
+            if (!restrictMoon || countsTowardQuorum(cpid, moonIn1)) ++count;
+            anyNeed = anyNeed || need.contains(cpid);
+            anyTrans = anyTrans || isTransiting(cpid);
+            if (fits && (fits = groupMasks::fits(cpid))) {
+                groupMasks::add(key, cpid);
+            }
         }
-        maybeAddGroup();
+        maybeAddGroup(e);
     }
+    for (unsigned n = 0; n < seen.size(); ++n) {
+        const auto& s = seen[n];
+        f(&masks.at(n), s.i, s.j, s.spread);
+    }
+}
+
+PlanetClusterMap
+findClusters(const std::vector<position>& pv,
+             unsigned quorum,
+             const PlanetSet& need /*={}*/,
+             bool skipAllNatalOnly = false,
+             bool restrictMoon = true,
+             qreal maxOrb = 8.)
+{
+    PlanetClusterMap ret;
+    eachCluster(pv, quorum, need, skipAllNatalOnly, restrictMoon, maxOrb,
+                [&](const groupMasks::key*, unsigned i, unsigned j,
+                    qreal spread)
+    { ret[getSet(pv.begin() + i, pv.begin() + j)] = spread; });
     return ret;
 }
 
+PlanetClusterMap
+findClusters(const positions& posits,
+             unsigned quorum,
+             const PlanetSet& need /*={}*/,
+             bool skipAllNatalOnly = false,
+             bool restrictMoon = true,
+             qreal maxOrb = 8.)
+{
+#if 0
+    qDebug() << "quorum" << quorum
+             << "need" << need.names()
+             << "skipAllNatalOnly" << skipAllNatalOnly
+             << "restrictMoon" << restrictMoon
+             << "maxOrb" << maxOrb;
+    qDebug() << toString(posits).c_str();
+    //if (posits.size() > 1) qDebug() << "\n";
+#endif
+    return findClusters(std::vector<position>(posits.begin(), posits.end()),
+                        quorum, need, skipAllNatalOnly, restrictMoon, maxOrb);
+}
+
 PlanetClusterMap
 findClusters(unsigned h,
              const PlanetProfile& plist,
@@ -4548,29 +5887,35 @@ findClusters(unsigned h,
              bool restrictMoon /*=true*/,
              qreal maxOrb /*=8.*/)
 {
+    FlatProfile flat(plist);
+    return findClusters(h, flat.all(), quorum, need,
+                        skipAllNatalOnly, restrictMoon, maxOrb);
+}
+
+PlanetClusterMap
+findClusters(unsigned h,
+             const FlatProfile::View& plist,
+             unsigned quorum,
+             const PlanetSet& need /*={}*/,
+             bool skipAllNatalOnly /*=false*/,
+             bool restrictMoon /*=true*/,
+             qreal maxOrb /*=8.*/)
+{
+    const auto& fp = *plist.prof;
     positions posits;
-    for (auto loc : plist) {
-        auto ploc = dynamic_cast<PlanetLoc*>(loc);
-        if (!ploc) continue;
+    for (auto i : plist.idx) {
+        if (!fp.isPlanet(i)) continue;
 
-        auto cpid = ploc->planet;
+        const auto& cpid = fp.ids[i];
         if (cpid.fileId() < 0) continue;
+        if (!clusterable(h, cpid.planetId())) continue;
 
-        auto pid = cpid.planetId();
-
-        if (h>1 && ((pid >= Houses_Start
-                    && pid < Houses_End)
-                    || (pid == Planet_IC
-                         || pid == Planet_Desc)))
-        { continue; }
-        if (h%2==0 && (pid == Planet_SouthNode)) continue;
-
-        auto hloc = h==1? ploc->rasiLoc() : harmonic(h,ploc->rasiLoc());
-        auto ins = posits.emplace(hloc,ploc->planet);
+        auto hloc = h==1? fp.rasi[i] : harmonic(h,fp.rasi[i]);
+        auto ins = posits.emplace(hloc,cpid);
         if (ins.first->first > 345) {
-            posits.emplace(ins.first->first-360.,ploc->planet);
+            posits.emplace(ins.first->first-360.,cpid);
         } else if (ins.first->first < 15) {
-            posits.emplace(ins.first->first+360.,ploc->planet);
+            posits.emplace(ins.first->first+360.,cpid);
         }
     }
 
@@ -4578,6 +5923,128 @@ findClusters(unsigned h,
                         skipAllNatalOnly, restrictMoon, maxOrb);
 }
 
+void
+ClusterRing::update(const FlatProfile::View& v,
+                    unsigned quorum,
+                    const PlanetSet& need /*={}*/,
+                    bool skipAllNatalOnly /*=false*/,
+                    bool restrictMoon /*=true*/,
+                    qreal maxOrb /*=8.*/)
+{
+    const auto& fp = *v.prof;
+    if (v.idx != _idx) {
+        _idx = v.idx;
+        _ring.clear();
+        for (auto i : v.idx) {
+            if (!fp.isPlanet(i)) continue;
+            const auto& cpid = fp.ids[i];
+            if (cpid.fileId() < 0) continue;
+            if (!clusterable(_h, cpid.planetId())) continue;
+            _ring.push_back({ 0, cpid, i });
+        }
+    }
+    for (auto& e: _ring) {
+        e.loc = _h==1? fp.rasi[e.i] : harmonic(_h,fp.rasi[e.i]);
+    }
+
+    // insertion sort, which has next to nothing to do when the bodies
+    // have barely moved since the last step
+    lessPosit less;
+    for (unsigned k = 1; k < _ring.size(); ++k) {
+        if (!less({ _ring[k].loc, _ring[k].id },
+                  { _ring[k-1].loc, _ring[k-1].id }))
+        { continue; }
+        auto e = _ring[k];
+        unsigned m = k;
+        for ( ; m > 0 && less({ e.loc, e.id },
+                              { _ring[m-1].loc, _ring[m-1].id }); --m)
+        {
+            _ring[m] = _ring[m-1];
+        }
+        _ring[m] = e;
+    }
+
+    // then the wrap-around copies at either end, as findClusters() has
+    _flat.clear();
+    auto n = unsigned(_ring.size());
+    auto tail = n;
+    while (tail > 0 && _ring[tail-1].loc > 345) --tail;
+    for (auto k = tail; k < n; ++k) {
+        _flat.emplace_back(_ring[k].loc - 360., _ring[k].id);
+    }
+    for (const auto& e: _ring) _flat.emplace_back(e.loc, e.id);
+    for (unsigned k = 0; k < n && _ring[k].loc < 15; ++k) {
+        _flat.emplace_back(_ring[k].loc + 360., _ring[k].id);
+    }
+
+    // update the clusters in place: most of them were there last step
+    _entered.clear();
+    _left.clear();
+    _hit.clear();
+    eachCluster(_flat, quorum, need, skipAllNatalOnly, restrictMoon, maxOrb,
+                [&](const groupMasks::key* k, unsigned i, unsigned j,
+                    qreal spread)
+    {
+        auto mit = k? _byMask.find(*k) : _byMask.end();
+        if (mit != _byMask.end()) {
+            mit->second->second = spread;
+            _hit.push_back(mit->second);
+            return;
+        }
+        auto ins = _clusters.emplace(getSet(_flat.begin() + i,
+                                            _flat.begin() + j), spread);
+        auto cl = &*ins.first;
+        if (ins.second) {
+            _entered.push_back(cl->first);
+            if (k) _byMask.emplace(*k, cl);
+        } else {
+            cl->second = spread;
+        }
+        _hit.push_back(cl);
+    });
+
+    std::sort(_hit.begin(), _hit.end());
+    for (auto it = _clusters.begin(); it != _clusters.end(); ) {
+        if (std::binary_search(_hit.begin(), _hit.end(), &*it)) {
+            ++it;
+            continue;
+        }
+        _left.push_back(it->first);
+        groupMasks::key k { 0, 0 };
+        bool fits = true;
+        for (const auto& cpid: it->first) {
+            if (!(fits = groupMasks::fits(cpid))) break;
+            groupMasks::add(k, cpid);
+        }
+        if (fits) _byMask.erase(k);
+        it = _clusters.erase(it);
+    }
+
+    _offers = _entered;
+    for (const auto& ps: _declined) {
+        if (_clusters.count(ps)) _offers.push_back(ps);
+    }
+    _declined.clear();
+}
+
+size_t
+ClusterRing::maskHash::operator()(const mask& k) const
+{ return groupMasks::hash(k); }
+
+void
+ClusterRing::clear()
+{
+    _idx.clear();
+    _ring.clear();
+    _clusters.clear();
+    _byMask.clear();
+    _hit.clear();
+    _entered.clear();
+    _left.clear();
+    _offers.clear();
+    _declined.clear();
+}
+
 PlanetClusterMap
 findClusters(unsigned h, double jd,
              const PlanetProfile& plist,
@@ -4595,13 +6062,7 @@ findClusters(unsigned h, double jd,
 
         auto cpid = ploc->planet;
         if (cpid.fileId() < 0 || cpid.fileId() >= int(pfid.size())) continue;
-        auto pid = cpid.planetId();
-        if (h>1 && ((pid >= Houses_Start
-                    && pid < Houses_End)
-                    || (pid == Planet_IC
-                         || pid == Planet_Desc)))
-        { continue; }
-        if (h%2==0 && (pid == Planet_SouthNode)) continue;
+        if (!clusterable(h, cpid.planetId())) continue;
 
         ++pfid[cpid.fileId()];
         const auto& ida = ids.at( qMax(ids.size()-1,cpid.fileId()) );
@@ -4661,23 +6122,33 @@ computeSpread(unsigned h,
               const PlanetProfile& prof,
               const QList<InputData>& ids)
 {
+    FlatProfile flat(prof);
+    return computeSpread(h, jd, flat.all(), ids);
+}
+
+qreal
+computeSpread(unsigned h,
+              double jd,
+              const FlatProfile::View& prof,
+              const QList<InputData>& ids)
+{
+    const auto& fp = *prof.prof;
     std::vector<qreal> sums(2, 0);
     std::vector<qreal> locs;
     std::vector<unsigned> c(2, 0);
-    for (auto loc: prof) {
-        auto ploc = dynamic_cast<PlanetLoc*>(loc);
-        if (!ploc) continue;
+    for (auto i : prof.idx) {
+        if (!fp.isPlanet(i)) continue;
 
-        auto cpid = ploc->planet;
+        const auto& cpid = fp.ids[i];
         if (cpid.fileId() < 0 && prof.size()>2) continue;
 
         qreal pos;
-        unsigned vroom(ploc->inMotion());
+        unsigned vroom(fp.inMotion(i));
         if (vroom && !ids.isEmpty()) {
             const auto& ida = ids.at( qMax(ids.size()-1,cpid.fileId()) );
             pos = PlanetLoc::compute(cpid,ida,jd).first;
         } else {
-            pos = ploc->_rasiLoc;
+            pos = fp.rasi[i];
         }
         if (h > 1) pos = harmonic(h,pos);
         /*if (vroom)*/ locs.emplace_back(pos);
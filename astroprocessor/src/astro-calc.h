@@ -2,8 +2,11 @@
 #define A_CALC_H
 
 #include "astro-data.h"
+#include "astro-chartcache.h"
 #include <QRunnable>
 #include <QEventLoop>
+#include <map>
+#include <memory>
 
 // Forward
 class AstroFile;
@@ -179,11 +182,11 @@ const ZodiacSign& getSign        ( float deg, const Zodiac& zodiac );
 int     getHouse                 ( const Houses& houses, float deg ); // returns 1...12
 int     getHouse                 ( ZodiacSignId sign, const Houses& houses, const Zodiac& zodiac );
 
-float   angle                    (const Star& body1, const Star& body2 );
+float   angle                    (const Star& body1, const Star& body2, aspectModeEnum mode = aspectMode );
 float   angle                    ( const Star& body, float deg );
 float   angle                    (const Star& body, QPointF coordinate );
 float   angle                    ( float deg1, float deg2 );
-AspectId aspect                  ( const Star& planet1, const Star& planet2, const AspectsSet& aspectSet );
+AspectId aspect                  ( const Star& planet1, const Star& planet2, const AspectsSet& aspectSet, aspectModeEnum mode = aspectMode );
 AspectId aspect                  ( const Star& planet, QPointF coordinate, const AspectsSet& aspectSet );
 AspectId aspect                  ( const Star& planet1, float degree, const AspectsSet& aspectSet );
 AspectId aspect                  ( float angle, const AspectsSet& aspectSet );
@@ -193,7 +196,7 @@ const Planet* doryphoros         ( const Horoscope& scope );
 const Planet* auriga             ( const Horoscope& scope );
 const Planet* almuten            ( const Horoscope& scope );
 bool    rulerDisposition         ( int house, int houseAuthority, const Horoscope& scope );
-bool    isEarlier                ( const Planet& planet, const Planet& sun );
+bool    isEarlier                ( const Planet& planet, const Planet& sun, aspectModeEnum mode = aspectMode );
 //const Planet& ruler          ( int house, const Horoscope& scope );
 PlanetId receptionWith           ( const Planet& planet, const Horoscope& scope );
 
@@ -206,8 +209,41 @@ void getPrimeFactors(unsigned h, uintSSet& ss);
 std::vector<bool> getPrimeSieve(unsigned top);
 uintMSet getPrimes(unsigned top);
 
+/// Everything findHarmonics() would otherwise take from the settings,
+/// and the harmonics and factors that follow from them, fixed when the
+/// context is prepared. A search only reads its context, so searches
+/// can share one or each have their own and run side by side.
+struct HarmonicContext {
+    HarmonicContext();          // from the current settings
+
+    struct Pass {
+        unsigned quorum;
+        qreal orb;
+        bool cleanup;
+    };
+
+    unsigned maxHarmonic;
+    unsigned primeFactorLimit;
+    unsigned minQuorum;
+    bool includeMidpoints;
+    bool requireAnchor;
+    aspectModeEnum aspectMode;
+    std::vector<Pass> passes;   // min to max quorum, orbs widening
+
+    std::vector<bool> primeSieve;       // 0...maxHarmonic
+    std::vector<unsigned> harmonics;    // the ones searched, ascending
+    std::vector<std::vector<unsigned>> factors; // of each, 1 but not itself
+
+    /// Recompute the sieve, harmonics and factors after changing
+    /// maxHarmonic or primeFactorLimit.
+    void prepare();
+};
+
 void findHarmonics(const ChartPlanetMap& cpm, PlanetHarmonics& hx);
-void calculateBaseChartHarmonic(Horoscope& scope);
+void findHarmonics(const ChartPlanetMap& cpm, PlanetHarmonics& hx,
+                   const HarmonicContext& context);
+void calculateBaseChartHarmonic(Horoscope& scope,
+                                aspectModeEnum mode = aspectMode);
 
 typedef QList<InputData> idlist;
 
@@ -314,8 +350,9 @@ public:
     AspectFinder(HarmonicEvents& evs,
                  const ADateRange& range,
                  const uintSSet& hset,
-                 goalType gt = afcFindAspects) :
-        EventOptions(current()),
+                 goalType gt = afcFindAspects,
+                 const EventOptions& opts = current()) :
+        EventOptions(opts),
         _evs(evs),
         _range(range),
         _gt(gt),
@@ -333,6 +370,22 @@ public:
     void findStations();
     void findAspectsAndPatterns();
 
+    /// stations, then aspects and patterns, on the calling thread
+    void search();
+
+    /// time step of the search loop, in days
+    double searchStep() const;
+
+    /// step transit positions from tl, where it has them
+    void setTimeline(const TransitTimeline* tl) { _timeline = tl; }
+
+    /// threads solving for exact times; 0 for the ideal thread count
+    void setSolverThreads(int n) { _solverThreads = n; }
+
+    /// chunks of the date range swept side by side, on the solver
+    /// threads; 0 for as many as there are of those
+    void setSweepThreads(int n) { _sweepThreads = n; }
+
 signals:
     void progress(double p);
 
@@ -340,14 +393,18 @@ public slots:
     void pause() { if (_state==runningState) _state = pauseRequestedState; }
     void resume() { if (_state==pauseRequestedState) _state = runningState; }
     void cancel() { if (_state==runningState) _state = cancelRequestedState; }
-    void findStuff();
+    virtual void findStuff();
+
+    /// running totals of per-thread ephemeris sessions
+    static int ephemerisOpens();
+    static int ephemerisCloses();
 
 protected:
     static void prepThread();
     static void releaseThread();
 
     void startTask() { prepThread(); ++_numTasks; }
-    void endTask() { releaseThread(); --_numTasks; }
+    void endTask() { --_numTasks; }
 
     bool outOfOrb(unsigned h,
                   std::initializer_list<const Loc*> locs,
@@ -401,6 +458,13 @@ protected:
     searchPairList _staff;
     unsigned _evType = etcUnknownEvent;
 
+    const TransitTimeline* _timeline = nullptr;
+    int _solverThreads = 0;
+    int _sweepThreads = 0;
+
+    /// as it was when the finder was made, on the caller's thread
+    aspectModeEnum _aspectMode = aspectModeEnum(aspectMode);
+
 private:
 };
 
@@ -409,8 +473,45 @@ public:
     OmnibusFinder(HarmonicEvents& evs,
                  const ADateRange& range,
                  const uintSSet& hset,
-                 const AstroFileList& files);
+                 const AstroFileList& files,
+                 const EventOptions& opts = current());
+
+};
 
+/// Searches any number of natal charts against one set of transits.
+/// The transits are stepped once, into a TransitTimeline that every
+/// chart's search reads from, and the charts are spread over a small
+/// work-stealing pool. Events involving a chart land in eventsFor()
+/// that chart; transit-only events (transits to transits, stations,
+/// ingresses and transit patterns) are searched once, into the
+/// finder's own list.
+class MultiChartFinder : public AspectFinder {
+    Q_OBJECT
+
+public:
+    MultiChartFinder(HarmonicEvents& evs,
+                     const ADateRange& range,
+                     const uintSSet& hset,
+                     const AstroFileList& charts,
+                     AstroFile* transits);
+
+    ~MultiChartFinder();
+
+    int charts() const { return int(_events.size()); }
+    HarmonicEvents& eventsFor(int chart) { return *_events[chart]; }
+
+    void findStuff() override;
+
+signals:
+    /// the chart's search is over and its events are final; from
+    /// whichever thread ran it
+    void chartFinished(int chart);
+
+private:
+    InputData _transits;
+    std::vector<std::unique_ptr<HarmonicEvents>> _events;
+    std::vector<std::unique_ptr<AspectFinder>> _finders;
+    std::map<double, std::unique_ptr<TransitTimeline>> _timelines;
 };
 
 class CoincidenceFinder : public QRunnable {
@@ -470,6 +571,85 @@ PlanetClusterMap findClusters(unsigned h,
                               bool restrictMoon = true,
                               qreal maxOrb = 8.);
 
+PlanetClusterMap findClusters(unsigned h,
+                              const FlatProfile::View& prof,
+                              unsigned quorum,
+                              const PlanetSet& need = {},
+                              bool skipAllNatalOnly = false,
+                              bool restrictMoon = true,
+                              qreal maxOrb = 8.);
+
+/// The slack harmonicDeltaCandidates() allows around contact and the
+/// 90-degree cutoff.
+constexpr double harmonicDeltaSlop = 1e-9;
+
+/// For n pairs at harmonic h, whether pair k's delta may have changed
+/// sign between a step where its bodies were at ai[k], aj[k] and one
+/// where they're at bi[k], bj[k]. Vectorized where the build allows.
+void harmonicDeltaCandidates(unsigned n, unsigned h,
+                             const double* ai, const double* aj,
+                             const double* bi, const double* bj,
+                             unsigned char* cand);
+
+/// The same, one pair at a time: what the vector path has to match.
+void harmonicDeltaCandidatesScalar(unsigned n, unsigned h,
+                                   const double* ai, const double* aj,
+                                   const double* bi, const double* bj,
+                                   unsigned char* cand);
+
+/// The clusterable positions of a FlatProfile::View at one harmonic,
+/// kept in order around the circle from one step of a search to the
+/// next. Bodies only trade places now and then, so update() repairs the
+/// order in place rather than sorting afresh. The clusters it finds are
+/// compared with the last step's to give what entered and what left;
+/// the ones that stay keep their entry, looked up by bitmask, so only
+/// what's new costs a PlanetSet.
+class ClusterRing {
+public:
+    explicit ClusterRing(unsigned h = 1) : _h(h) { }
+
+    /// reposition from v and find the clusters, as findClusters() would
+    void update(const FlatProfile::View& v,
+                unsigned quorum,
+                const PlanetSet& need = {},
+                bool skipAllNatalOnly = false,
+                bool restrictMoon = true,
+                qreal maxOrb = 8.);
+
+    void clear();
+
+    const PlanetClusterMap& clusters() const { return _clusters; }
+
+    /// since the last update()
+    const std::vector<PlanetSet>& entered() const { return _entered; }
+    const std::vector<PlanetSet>& left() const { return _left; }
+
+    /// What's worth considering as new: what entered, plus whatever was
+    /// declined since the last update() and is still clustered.
+    const std::vector<PlanetSet>& offers() const { return _offers; }
+    void decline(const PlanetSet& ps) { _declined.push_back(ps); }
+
+private:
+    struct entry {
+        qreal loc;
+        ChartPlanetId id;
+        unsigned i;         ///< into the view's profile
+    };
+
+    unsigned _h;
+    std::vector<unsigned> _idx;     ///< the view the ring was built from
+    std::vector<entry> _ring;
+    std::vector<std::pair<qreal, ChartPlanetId>> _flat;
+    PlanetClusterMap _clusters;
+
+    typedef std::pair<quint64, quint64> mask;
+    struct maskHash { size_t operator()(const mask& k) const; };
+    std::unordered_map<mask, PlanetClusterMap::value_type*,
+                       maskHash> _byMask;   ///< clusters that fit a mask
+    std::vector<PlanetClusterMap::value_type*> _hit;
+    std::vector<PlanetSet> _entered, _left, _offers, _declined;
+};
+
 PlanetClusterMap findClusters(unsigned h, double jd,
                               const PlanetProfile& prof,
                               const QList<InputData>& ids,
@@ -495,9 +675,41 @@ inline
 qreal computeSpread(unsigned h, const PlanetProfile& prof)
 { return computeSpread(h, 0, prof, {}); }
 
+qreal computeSpread(unsigned h,
+                    double jd,
+                    const FlatProfile::View& prof,
+                    const QList<InputData>& ids);
+
+inline
+qreal computeSpread(unsigned h, const FlatProfile::View& prof)
+{ return computeSpread(h, 0, prof, {}); }
+
+/// What every body calculated for one moment and place has in common:
+/// nutation, obliquity, sidereal time, the ayanamsa and the Sun (for
+/// phases). With one of these a body is a single swe_calc_ut(), and its
+/// equatorial and horizontal coordinates follow by rotation.
+struct EphemerisFrame {
+    EphemerisFrame(const InputData& input, ZodiacId zid);
+
+    double jd;
+    ZodiacId zid;
+    double geopos[3];
+    double epsTrue, epsMean;
+    double nutLon, nutLonSpeed;     // the speed only for sidereal zodiacs
+    double armc;
+    double aya = 0, ayaSpeed = 0;   // sidereal zodiacs, nutation included
+    int sunFlags;
+    double sun[6];                  // tropical, true ecliptic of date
+
+    void toEquatorial(const double* ecl, double* equ) const;
+    void toHorizontal(const double* ecl, double* hor) const;
+    void phase(const double* ecl, double& phaseAngle, double& elongation) const;
+};
+
 Planet      calculatePlanet      ( PlanetId planet, const InputData& input, const Houses& houses, const Zodiac& zodiac );
+Planet      calculatePlanet      ( PlanetId planet, const InputData& input, const Houses& houses, const Zodiac& zodiac, const EphemerisFrame& frame );
 Star calculateStar(const QString&, const InputData& input, const Houses& houses, const Zodiac& zodiac);
-PlanetPower calculatePlanetPower ( const Planet& planet, const Horoscope& scope );
+PlanetPower calculatePlanetPower ( const Planet& planet, const Horoscope& scope, aspectModeEnum mode = aspectMode );
 Houses      calculateHouses      ( const InputData& input );
 Aspect      calculateAspect      ( const AspectsSet& aspectSet, const Planet& planet1, const Planet& planet2 );
 Aspect calculateAspect(const AspectsSet&, const Loc*, const Loc*);
@@ -524,7 +736,30 @@ QList<QDateTime> quotidianSearch(PlanetProfile& poses,
                                  double span,
                                  bool forceMin);
 
-Horoscope   calculateAll         ( const InputData& input );
+Horoscope   calculateAll         ( const InputData& input, aspectModeEnum mode = aspectMode );
+
+/// What a change of input invalidates, from the top down: a new time
+/// or zodiac means new positions and so everything; a new place keeps
+/// the ecliptic and equatorial positions but not the houses, horizontal
+/// coordinates or angle transits; a new house system only the cusps and
+/// what falls in them; and the harmonic, aspect set or aspect mode only
+/// the base harmonic chart. Aspects are left to whoever shows them.
+enum ChartPart {
+    chartPositions = 0x1,
+    chartLocation  = 0x2,
+    chartHouses    = 0x4,
+    chartHarmonic  = 0x8
+};
+Q_DECLARE_FLAGS(ChartParts, ChartPart)
+
+/// Bring scope up to date with its inputData, redoing only what
+/// depends on parts. Off the GUI thread, pass the aspect mode the
+/// request was made under rather than reading the global.
+void recalculate(Horoscope& scope, ChartParts parts,
+                 aspectModeEnum mode = aspectMode);
 
 }
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(A::ChartParts)
+
 #endif // A_CALC_H
@@ -0,0 +1,137 @@
+#include <QCache>
+#include <QMutex>
+
+#include <tuple>
+
+#include "astro-calc.h"
+#include "astro-chartcache.h"
+
+namespace A {
+
+namespace {
+
+// What of the input a chart depends on. Process-wide settings -- the
+// stars and asteroids selected, orbs, the default house system and the
+// like -- aren't in the key: whoever changes them has to call
+// HoroscopeCache::clear(), as AstroWidget::applySettings() does. The
+// location is a QVector3D, so it's keyed as the floats it holds.
+struct chartKey {
+    qint64 msecs;
+    float lon, lat, alt;
+    int houseSystem, zodiac, aspectSet, aspectMode;
+
+    chartKey(const InputData& input, int mode) :
+        msecs(input.GMT().toMSecsSinceEpoch()),
+        lon(input.location().x()),
+        lat(input.location().y()),
+        alt(input.location().z()),
+        houseSystem(input.houseSystem()),
+        zodiac(input.zodiac()),
+        aspectSet(input.aspectSet()),
+        aspectMode(mode)
+    { }
+
+    auto tie() const
+    {
+        return std::tie(msecs, lon, lat, alt,
+                        houseSystem, zodiac, aspectSet, aspectMode);
+    }
+
+    bool operator==(const chartKey& other) const
+    { return tie() == other.tie(); }
+};
+
+uint
+qHash(const chartKey& key, uint seed = 0)
+{
+    auto mix = [&seed](uint h) {
+        seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    mix(::qHash(key.msecs));
+    mix(::qHash(key.lon));
+    mix(::qHash(key.lat));
+    mix(::qHash(key.alt));
+    mix(::qHash(key.houseSystem));
+    mix(::qHash(key.zodiac));
+    mix(::qHash(key.aspectSet));
+    mix(::qHash(key.aspectMode));
+    return seed;
+}
+
+QMutex s_mutex;
+QCache<chartKey, Horoscope> s_charts(32);
+HoroscopeCache::Stats s_stats;
+
+} // anonymous-namespace
+
+/*static*/
+Horoscope
+HoroscopeCache::calculate(const InputData& input)
+{ return calculate(input, aspectModeEnum(aspectMode)); }
+
+/*static*/
+Horoscope
+HoroscopeCache::calculate(const InputData& input, int mode)
+{
+    chartKey key(input, mode);
+    {
+        QMutexLocker ml(&s_mutex);
+        if (auto scope = s_charts.object(key)) {
+            ++s_stats.hits;
+            Horoscope ret = *scope;
+            ret.inputData = input;  // same chart, but keep the details
+            return ret;
+        }
+        ++s_stats.misses;
+    }
+
+    // Calculate without the lock; two threads after the same chart
+    // just both calculate it.
+    Horoscope ret = calculateAll(input, aspectModeEnum(mode));
+
+    QMutexLocker ml(&s_mutex);
+    s_charts.insert(key, new Horoscope(ret));
+    return ret;
+}
+
+/*static*/
+void
+HoroscopeCache::clear()
+{
+    QMutexLocker ml(&s_mutex);
+    s_charts.clear();
+}
+
+/*static*/
+int
+HoroscopeCache::capacity()
+{
+    QMutexLocker ml(&s_mutex);
+    return s_charts.maxCost();
+}
+
+/*static*/
+void
+HoroscopeCache::setCapacity(int charts)
+{
+    QMutexLocker ml(&s_mutex);
+    s_charts.setMaxCost(charts);
+}
+
+/*static*/
+HoroscopeCache::Stats
+HoroscopeCache::stats()
+{
+    QMutexLocker ml(&s_mutex);
+    return s_stats;
+}
+
+/*static*/
+void
+HoroscopeCache::resetStats()
+{
+    QMutexLocker ml(&s_mutex);
+    s_stats = Stats();
+}
+
+} // namespace A
@@ -0,0 +1,40 @@
+#ifndef A_CHARTCACHE_H
+#define A_CHARTCACHE_H
+
+#include <QtGlobal>
+#include "astro-data.h"
+
+namespace A {
+
+/// The last few charts calculateAll() made, most recently used first,
+/// so that the same chart opened again (another tab, swapped files, a
+/// chart reopened from the database) is a copy rather than a
+/// calculation. Charts are told apart by time, place, house system,
+/// zodiac, aspect set and the aspect mode in force.
+class HoroscopeCache {
+public:
+    /// calculateAll(input), from the cache when it can be.
+    static Horoscope calculate(const InputData& input);
+
+    /// The same under the given aspectModeEnum rather than the current
+    /// one, for use off the GUI thread.
+    static Horoscope calculate(const InputData& input, int aspectMode);
+
+    /// Forget every chart, e.g. when settings they depend on change.
+    static void clear();
+
+    static int capacity();
+    static void setCapacity(int charts);
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+    };
+
+    static Stats stats();
+    static void resetStats();
+};
+
+} // namespace A
+
+#endif // A_CHARTCACHE_H
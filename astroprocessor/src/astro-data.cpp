@@ -640,7 +640,8 @@ Star::timeToDT(double t, bool greg/*=true*/)
 
 void
 PlanetGroups::insert(const PlanetQueue & planets,
-                     unsigned minQuorum)
+                     unsigned minQuorum,
+                     bool needAnchor)
 {
     PlanetSet plist;
     getPlanetSet(planets, plist);
@@ -668,7 +669,7 @@ PlanetGroups::insert(const PlanetQueue & planets,
         return;
     }
     if (pl.size() > 1
-        && (anySolo || (!requireAnchor()
+        && (anySolo || (!needAnchor
                         && (!pl.empty() && !pl.begin()->isOppMidpt())))
         && pl.pop() >= minQuorum) {
         insert(value_type(pl, r));
@@ -870,6 +871,56 @@ EventStore::getEventUpdateScope(EventScope evscope,
     return { out, it->events };
 }
 
+void
+HarmonicEvents::post(HarmonicEvent&& ev)
+{
+    auto pe = new postedEvent;
+    pe->ev.emplace_back(std::move(ev));
+    pe->next = _posted.load(std::memory_order_relaxed);
+    while (!_posted.compare_exchange_weak(pe->next, pe,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed))
+    { }
+}
+
+size_t
+HarmonicEvents::publish()
+{
+    auto pe = _posted.exchange(nullptr, std::memory_order_acquire);
+    if (!pe) return 0;
+
+    // the stack comes back newest first
+    postedEvent* fifo = nullptr;
+    while (pe) {
+        auto next = pe->next;
+        pe->next = fifo;
+        fifo = pe;
+        pe = next;
+    }
+
+    size_t n = 0;
+    QMutexLocker ml(&mutex);
+    while (fifo) {
+        auto next = fifo->next;
+        splice(end(), fifo->ev);
+        delete fifo;
+        fifo = next;
+        ++n;
+    }
+    return n;
+}
+
+void
+HarmonicEvents::discardPosted()
+{
+    auto pe = _posted.exchange(nullptr, std::memory_order_acquire);
+    while (pe) {
+        auto next = pe->next;
+        delete pe;
+        pe = next;
+    }
+}
+
 double Planet::getPrefPos() const
 {
     switch (aspectMode) {
@@ -16,6 +16,9 @@
 
 #include <set>
 #include <deque>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
 #include <algorithm>
 #include <fstream>
 
@@ -582,6 +585,56 @@ public:
 };
 
 typedef QMap<std::string, Star> StarMap;
+
+/// A chart's stars sorted by ecliptic longitude, so the ones within an
+/// orb of a point are found by binary search rather than by a pass over
+/// the StarMap. Entries are by name, since the StarMap gets copied and
+/// detached along with its Horoscope.
+class StarIndex {
+public:
+    void rebuild(const StarMap& stars);
+    bool isEmpty() const { return _ecliptic.empty(); }
+
+    /// Calls f(name) for each star within orb of longitude lon.
+    template <typename F>
+    void forEachNear(qreal lon, qreal orb, F f) const;
+
+private:
+    struct entry {
+        qreal lon;
+        std::string name;
+        bool operator<(const entry& other) const { return lon < other.lon; }
+    };
+    std::vector<entry> _ecliptic;
+};
+
+template <typename F>
+void
+StarIndex::forEachNear(qreal lon, qreal orb, F f) const
+{
+    if (orb >= 180) {
+        for (const auto& e : _ecliptic) f(e.name);
+        return;
+    }
+    auto scan = [&](qreal from, qreal to) {
+        auto it = std::lower_bound(_ecliptic.begin(), _ecliptic.end(), from,
+                                   [](const entry& e, qreal l)
+                                   { return e.lon < l; });
+        for (; it != _ecliptic.end() && it->lon <= to; ++it) f(it->name);
+    };
+    lon = fmod(lon, 360.);
+    if (lon < 0) lon += 360;
+    qreal from = lon - orb, to = lon + orb;
+    if (from < 0) {
+        scan(from + 360, 360);
+        scan(0, to);
+    } else if (to >= 360) {
+        scan(from, 360);
+        scan(0, to - 360);
+    } else {
+        scan(from, to);
+    }
+}
 typedef std::pair<int, QString> GlyphName;
 
 const PlanetMap& getPlanetMap();
@@ -899,6 +952,36 @@ public:
     }
 };
 
+/// Hashing and equality for PlanetSets as keys of unordered maps. Equal
+/// means what it does in a std::map<PlanetSet,...>: the same members
+/// by ChartPlanetId's ordering, which, unlike its operator==, tells a
+/// midpoint from its opposite.
+struct PlanetSetHash {
+    size_t operator()(const PlanetSet& ps) const
+    {
+        size_t h = ps.size();
+        for (const auto& cpid : ps) {
+            size_t v = size_t(cpid.fileId() + 1) << 20
+                    ^ size_t(cpid.planetId() + 1) << 10
+                    ^ size_t(cpid.planetId2() + 1) << 1
+                    ^ size_t(cpid.isOppMidpt());
+            h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+struct PlanetSetEqual {
+    bool operator()(const PlanetSet& a, const PlanetSet& b) const
+    {
+        return a.size() == b.size()
+                && std::equal(a.begin(), a.end(), b.begin(),
+                              [](const ChartPlanetId& x,
+                                 const ChartPlanetId& y)
+        { return !(x < y) && !(y < x); });
+    }
+};
+
 class ChartPlanetBitmap : public std::map<int, unsigned> {
     static unsigned maxShift()
     {
@@ -1116,7 +1199,8 @@ std::ostream &
 operator<<(std::ostream& os, const ClusterOrbWhen& cow)
 { return os << QString(cow).toLocal8Bit().constData(); }
 
-typedef std::map<PlanetSet, ClusterOrbWhen> PlanetClusterMap;
+typedef std::unordered_map<PlanetSet, ClusterOrbWhen,
+                           PlanetSetHash, PlanetSetEqual> PlanetClusterMap;
 typedef std::map<unsigned, PlanetClusterMap> HarmonicPlanetClusters;
 
 class NatalLoc : public PlanetLoc {
@@ -1283,6 +1367,7 @@ using hsetId = unsigned short int;
 struct planetsEtc : public uintPair {
     hsetId hsid;
     EventType et;
+    unsigned slot = 0;  ///< index into the finder's flattened pair arrays
 
     using uintPair::uintPair;
 
@@ -1396,6 +1481,10 @@ public:
 
     static std::pair<qreal, qreal> computeDelta(const Loc* a,
                                                 const Loc* b,
+                                                unsigned int harmonic = 1)
+    { return computeDelta(a->loc, a->speed, b->loc, b->speed, harmonic); }
+    static std::pair<qreal, qreal> computeDelta(qreal aloc, qreal aspeed,
+                                                qreal bloc, qreal bspeed,
                                                 unsigned int harmonic = 1);
     static std::pair<qreal, qreal> computeSpread(std::initializer_list<const Loc *>,
                                                  unsigned int =1);
@@ -1410,6 +1499,123 @@ public:
     { return _forceMinimize || size() > 2; }
 };
 
+/// Transit positions and speeds sampled once on a fixed grid of julian
+/// days, jd0 + k*step, and then shared read-only by any number of
+/// FlatProfiles stepping over the same grid, e.g. one per natal chart
+/// searched against the same transits.
+class TransitTimeline {
+public:
+    TransitTimeline(const InputData& ida,
+                    const PlanetSet& bodies,
+                    double jd0, double step, unsigned steps);
+
+    const InputData& input() const { return _ida; }
+    double step() const { return _step; }
+
+    /// whether bodies computed from ida are the ones sampled: the same
+    /// chart, place and zodiac as the timeline's input
+    bool serves(const InputData& ida) const;
+    unsigned steps() const { return _steps; }
+
+    /// column of a sampled body, or -1
+    int column(const ChartPlanetId& cpid) const;
+
+    /// row of a grid point, or -1 if jd isn't one
+    int row(double jd) const;
+
+    qreal loc(int row, int col) const { return _loc[row * _cols + col]; }
+    qreal speed(int row, int col) const { return _speed[row * _cols + col]; }
+
+private:
+    InputData _ida;
+    std::vector<ChartPlanetId> _bodies;
+    double _jd0;
+    double _step;
+    unsigned _steps;
+    unsigned _cols;
+    std::vector<qreal> _loc;
+    std::vector<qreal> _speed;
+};
+
+/// Structure-of-arrays copy of a PlanetProfile for the search loops.
+/// Positions and speeds live in flat vectors, moving entries are
+/// recomputed in one pass, and subsets are index lists rather than
+/// cloned profiles.
+class FlatProfile {
+public:
+    enum Kind : unsigned char {
+        flatOther,      ///< not a PlanetLoc; never clustered
+        flatFixed,      ///< natal or otherwise not in motion
+        flatTransit,    ///< recomputed from its InputData
+        flatKnown       ///< KnownPosition, e.g., a station
+    };
+
+    std::vector<ChartPlanetId> ids;
+    std::vector<qreal> loc;         ///< Loc::loc
+    std::vector<qreal> rasi;        ///< PlanetLoc::rasiLoc()
+    std::vector<qreal> speed;
+    std::vector<unsigned char> kind;
+    std::vector<unsigned char> allow;   ///< PlanetLoc::allowAspects
+    std::vector<double> knownJD;    ///< KnownPosition::julianDate()
+    std::vector<const InputData*> input;
+    std::vector<int> column;        ///< TransitTimeline column, or -1
+
+    /// where computeAt() looks first, if anywhere
+    const TransitTimeline* timeline = nullptr;
+
+    /// index list into a FlatProfile, reusable across steps
+    struct View {
+        const FlatProfile* prof = nullptr;
+        std::vector<unsigned> idx;
+
+        unsigned size() const { return unsigned(idx.size()); }
+        unsigned operator[](unsigned k) const { return idx[k]; }
+    };
+
+    FlatProfile() { }
+    explicit FlatProfile(const PlanetProfile& prof) { assign(prof); }
+
+    void assign(const PlanetProfile& prof);
+
+    unsigned size() const { return unsigned(kind.size()); }
+    bool empty() const { return kind.empty(); }
+
+    bool isPlanet(unsigned i) const { return kind[i] != flatOther; }
+    bool inMotion(unsigned i) const { return kind[i] == flatTransit; }
+
+    bool aspectable(unsigned i) const
+    {
+        return inMotion(i)
+                || allow[i] <= PlanetLoc::aspOnlyConj
+                || (speed[i] <= 0 && allow[i] == PlanetLoc::aspOnlyRetro)
+                || (speed[i] >= 0 && allow[i] == PlanetLoc::aspOnlyDirect);
+    }
+
+    /// recompute every moving entry at jd (harmonic 1)
+    void computeAt(double jd);
+
+    /// take transit positions from tl wherever it has them
+    void useTimeline(const TransitTimeline* tl);
+
+    std::pair<qreal, qreal> delta(unsigned i, unsigned j,
+                                  unsigned h = 1) const
+    {
+        return PlanetProfile::computeDelta(loc[i], speed[i],
+                                           loc[j], speed[j], h);
+    }
+
+    void view(const PlanetSet& ps, View& v) const;
+    void viewAll(View& v) const;
+    View all() const { View v; viewAll(v); return v; }
+
+    FlatProfile subset(const PlanetSet& ps) const;
+
+    void swap(FlatProfile& other);
+
+private:
+    void append(const FlatProfile& from, unsigned i);
+};
+
 struct BySpeed {
     bool operator()(const PlanetLoc& a,
                     const PlanetLoc& b) const
@@ -1500,7 +1706,8 @@ public:
         insert(value_type(plist, planets));
     }
 
-    void insert(const PlanetQueue& planets, unsigned minQuorum = 2);
+    void insert(const PlanetQueue& planets, unsigned minQuorum = 2,
+                bool needAnchor = requireAnchor());
 };
 
 enum EventUpdateType {
@@ -1551,7 +1758,45 @@ typedef std::pair<unsigned, PlanetSet> HarmonicPlanetSet;
 typedef std::pair<double, double> JDateRange;
 typedef std::set<JDateRange> JDateRanges;
 typedef std::map<JDateRange, unsigned char> JDateRangeHits;
-typedef std::map<HarmonicPlanetSet, JDateRange> HarmonicPlanetDateRangeMap;
+/// Two bodies at a harmonic, held by value: the key the transit sweeps
+/// look up for every pair at every step, so it mustn't allocate. The
+/// pair is kept in ChartPlanetId order, and equal means what it does
+/// for PlanetSet.
+struct HarmonicPair {
+    unsigned h;
+    ChartPlanetId a, b;
+
+    HarmonicPair() : h() { }
+    HarmonicPair(unsigned h, const ChartPlanetId& x, const ChartPlanetId& y) :
+        h(h), a(y < x? y : x), b(y < x? x : y)
+    { }
+
+    PlanetSet planets() const { return PlanetSet { a, b }; }
+    HarmonicPlanetSet toSet() const { return { h, planets() }; }
+
+    bool operator==(const HarmonicPair& o) const
+    {
+        return h == o.h
+                && !(a < o.a) && !(o.a < a)
+                && !(b < o.b) && !(o.b < b);
+    }
+};
+
+struct HarmonicPairHash {
+    size_t operator()(const HarmonicPair& hp) const
+    {
+        auto v = [](const ChartPlanetId& cpid) {
+            return size_t(cpid.fileId() + 1) << 20
+                    ^ size_t(cpid.planetId() + 1) << 10
+                    ^ size_t(cpid.planetId2() + 1) << 1
+                    ^ size_t(cpid.isOppMidpt());
+        };
+        return (v(hp.a) * 31 + v(hp.b)) * 31 + hp.h;
+    }
+};
+
+typedef std::unordered_map<HarmonicPair, JDateRange,
+                           HarmonicPairHash> HarmonicPairDateRangeMap;
 typedef std::map<HarmonicPlanetSet, JDateRangeHits> HarmonicPlanetDateRangesMap;
 
 class HarmonicAspect {
@@ -1734,6 +1979,8 @@ public:
         eventsType(other.eventsType)
     { }
 
+    ~HarmonicEvents() { discardPosted(); }
+
     HarmonicEvents& operator=(const HarmonicEvents& other)
     {
         HarmonicEventsBase& me(*this);
@@ -1746,7 +1993,26 @@ public:
 
     operator const HarmonicEvents*() const { return this; }
 
+    void clear() { discardPosted(); HarmonicEventsBase::clear(); }
+
+    /// Hand off a finished event from any thread. It stays invisible to
+    /// readers of the list until the next publish().
+    void post(HarmonicEvent&& ev);
+
+    /// Splice everything posted so far onto the end of the list, in the
+    /// order posted, under the mutex. Returns the number of events added.
+    size_t publish();
+
     QMutex mutex;
+
+private:
+    struct postedEvent {
+        HarmonicEventsBase ev;      // one element, so it splices for free
+        postedEvent* next;
+    };
+    std::atomic<postedEvent*> _posted { nullptr };
+
+    void discardPosted();
 };
 
 typedef std::set<ADateRange> ADateRangeSet;
@@ -1804,6 +2070,7 @@ struct Horoscope
                mars, jupiter, saturn, uranus,
                neptune, pluto, northNode;
     StarMap    stars;
+    StarIndex  starIndex;
     double     harmonic = 1.0;
 
     ChartPlanetMap getOrigChartPlanets(int fileId) const
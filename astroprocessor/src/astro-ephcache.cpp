@@ -0,0 +1,331 @@
+#include <QCoreApplication>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QThread>
+#include <QDebug>
+
+#include <math.h>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "astro-ephcache.h"
+
+#include <swephexp.h>
+
+namespace A {
+
+namespace {
+
+constexpr double pi = 3.14159265358979323846;
+constexpr unsigned chebNodes = 12;  // nodes (and coefficients) per piece
+constexpr unsigned maxSplitLevel = 4;   // at most 16 pieces per segment
+
+/// base segment length, in days, before any subdivision
+double
+segmentDays(int sweNum)
+{
+    switch (sweNum) {
+    case SE_MOON:
+    case SE_TRUE_NODE:
+    case SE_OSCU_APOG:  return 2;
+    case SE_SUN:
+    case SE_MERCURY:
+    case SE_VENUS:
+    case SE_MARS:       return 8;
+    default:            return 32;
+    }
+}
+
+struct chebSegment {
+    double jd0 = 0;
+    double pieceLen = 0;
+    unsigned pieces = 0;
+    bool direct = false;
+    std::vector<double> pos;    // pieces * chebNodes
+    std::vector<double> spd;
+
+    static double clenshaw(const double* c, double x)
+    {
+        double b1 = 0, b2 = 0;
+        for (int j = chebNodes - 1; j >= 1; --j) {
+            double t = 2*x*b1 - b2 + c[j];
+            b2 = b1;
+            b1 = t;
+        }
+        return x*b1 - b2 + c[0]/2;
+    }
+
+    void eval(double jd, double& p, double& s) const
+    {
+        unsigned i = qMin(unsigned(qMax(0., (jd - jd0) / pieceLen)),
+                          pieces - 1);
+        double a = jd0 + i*pieceLen;
+        double x = 2*(jd - a)/pieceLen - 1;
+        p = swe_degnorm(clenshaw(&pos[i*chebNodes], x));
+        s = clenshaw(&spd[i*chebNodes], x);
+    }
+};
+
+typedef std::tuple<int, int, int, qint64> segKey;  // body,flags,sid,index
+typedef std::shared_ptr<const chebSegment> segPtr;
+
+QReadWriteLock s_lock;
+std::map<segKey, segPtr> s_segments;
+std::multimap<double, double> s_windows;
+QAtomicInt s_generation;
+
+QMutex s_statsMutex;
+EphemerisCache::Stats s_stats;
+
+// The segments each thread used last, one per body and flags as far
+// as the hash keeps them apart, so that a step going round the bodies
+// finds them all again without taking the lock.
+struct recentSegments {
+    static constexpr unsigned size = 32;
+
+    struct entry {
+        int generation = -1;
+        segKey key;
+        segPtr seg;
+    };
+    entry slots[size];
+
+    entry& slot(const segKey& key)
+    {
+        uint h = uint(std::get<0>(key)) * 0x9e3779b1u
+                ^ uint(std::get<1>(key)) * 0x85ebca6bu
+                ^ uint(std::get<2>(key) + 1);
+        return slots[(h ^ h >> 16) % size];
+    }
+};
+thread_local recentSegments st_recent;
+
+// windows this thread opened and hasn't closed
+thread_local int st_opened = 0;
+
+/// The GUI thread only gets approximations inside windows it opened
+/// itself: its charts and one-off calculations shouldn't change just
+/// because a search elsewhere has a window open. Pool threads only
+/// ever work for a search, so they're served inside any window.
+bool
+served()
+{
+    if (st_opened) return true;
+    auto app = QCoreApplication::instance();
+    return !app || QThread::currentThread() != app->thread();
+}
+
+bool
+sample(int sweNum, int flags, double jd, double& p, double& s)
+{
+    char errStr[256] = "";
+    double xx[6];
+    if (swe_calc_ut(jd, sweNum, flags | SEFLG_SPEED, xx, errStr) == ERR) {
+        return false;
+    }
+    p = xx[0];
+    s = xx[3];
+    return true;
+}
+
+/// Fit one piece [a, a+len]; returns false if the direct call fails or
+/// the verified error exceeds tolerance.
+bool
+fitPiece(int sweNum, int flags, double a, double len,
+         double* cpos, double* cspd,
+         double& posErr, double& spdErr, quint64& calls)
+{
+    constexpr unsigned N = chebNodes;
+    double fp[N], fs[N];
+
+    // nodes in ascending time so longitude can be unwrapped as we go
+    for (unsigned n = 0; n < N; ++n) {
+        unsigned k = N - 1 - n;
+        double x = cos(pi*(k+.5)/N);
+        if (!sample(sweNum, flags, a + (x+1)/2*len, fp[k], fs[k])) {
+            return false;
+        }
+        ++calls;
+        if (n > 0) {
+            double prev = fp[k+1];
+            fp[k] = prev + remainder(fp[k] - prev, 360.);
+        }
+    }
+
+    for (unsigned j = 0; j < N; ++j) {
+        double sp = 0, ss = 0;
+        for (unsigned k = 0; k < N; ++k) {
+            double c = cos(pi*j*(k+.5)/N);
+            sp += fp[k]*c;
+            ss += fs[k]*c;
+        }
+        cpos[j] = 2.*sp/N;
+        cspd[j] = 2.*ss/N;
+    }
+
+    // check halfway between adjacent nodes, and at both ends
+    for (unsigned k = 0; k <= N; ++k) {
+        double x = (k == 0)? 1
+                 : (k == N)? -1
+                 : cos(pi*k/N);
+        double p, s;
+        if (!sample(sweNum, flags, a + (x+1)/2*len, p, s)) return false;
+        ++calls;
+        double ep = fabs(remainder(p - chebSegment::clenshaw(cpos, x), 360.));
+        double es = fabs(s - chebSegment::clenshaw(cspd, x));
+        posErr = qMax(posErr, ep);
+        spdErr = qMax(spdErr, es);
+        if (ep > EphemerisCache::posTolerance
+                || es > EphemerisCache::spdTolerance)
+        { return false; }
+    }
+    return true;
+}
+
+segPtr
+fitSegment(int sweNum, int flags, int sidMode, qint64 index)
+{
+    auto seg = std::make_shared<chebSegment>();
+    double days = segmentDays(sweNum);
+    seg->jd0 = index * days;
+
+    if (flags & SEFLG_SIDEREAL) swe_set_sid_mode(sidMode, 0, 0);
+
+    quint64 calls = 0;
+    double posErr = 0, spdErr = 0;
+    bool ok = false;
+    for (unsigned level = 0; !ok && level <= maxSplitLevel; ++level) {
+        seg->pieces = 1u << level;
+        seg->pieceLen = days / seg->pieces;
+        seg->pos.assign(seg->pieces * chebNodes, 0.);
+        seg->spd.assign(seg->pieces * chebNodes, 0.);
+        double pe = 0, se = 0;
+        ok = true;
+        for (unsigned i = 0; ok && i < seg->pieces; ++i) {
+            ok = fitPiece(sweNum, flags,
+                          seg->jd0 + i*seg->pieceLen, seg->pieceLen,
+                          &seg->pos[i*chebNodes], &seg->spd[i*chebNodes],
+                          pe, se, calls);
+        }
+        if (ok) posErr = pe, spdErr = se;
+    }
+    if (!ok) {
+        seg->direct = true;
+        seg->pos.clear();
+        seg->spd.clear();
+    }
+
+    QMutexLocker ml(&s_statsMutex);
+    s_stats.sweCalls += calls;
+    if (ok) {
+        ++s_stats.segmentsFit;
+        s_stats.maxPosError = qMax(s_stats.maxPosError, posErr);
+        s_stats.maxSpdError = qMax(s_stats.maxSpdError, spdErr);
+    } else {
+        ++s_stats.segmentsDirect;
+        qDebug() << "EphemerisCache: serving body" << sweNum
+                 << "directly from jd" << seg->jd0;
+    }
+    return seg;
+}
+
+bool
+inWindow(double jd)
+{
+    for (auto it = s_windows.begin();
+         it != s_windows.end() && it->first <= jd; ++it)
+    {
+        if (jd <= it->second) return true;
+    }
+    return false;
+}
+
+} // anonymous-namespace
+
+EphemerisCache::Window::Window(double jd1, double jd2) :
+    _jd1(qMin(jd1, jd2)),
+    _jd2(qMax(jd1, jd2))
+{
+    ++st_opened;
+    QWriteLocker wl(&s_lock);
+    s_windows.emplace(_jd1, _jd2);
+}
+
+EphemerisCache::Window::~Window()
+{
+    if (--st_opened == 0) st_recent = recentSegments();
+    QWriteLocker wl(&s_lock);
+    auto range = s_windows.equal_range(_jd1);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == _jd2) {
+            s_windows.erase(it);
+            break;
+        }
+    }
+    if (s_windows.empty()) {
+        s_segments.clear();
+        ++s_generation;
+    }
+}
+
+/*static*/
+bool
+EphemerisCache::lookup(int sweNum, int flags, int sidMode,
+                       double jd, double& pos, double& speed)
+{
+    if (!(flags & SEFLG_SIDEREAL)) sidMode = -1;
+    flags &= ~SEFLG_SPEED;
+    qint64 index = qint64(floor(jd / segmentDays(sweNum)));
+    segKey key { sweNum, flags, sidMode, index };
+
+    int gen = s_generation;
+    auto& recent = st_recent.slot(key);
+    segPtr seg;
+    if (recent.generation == gen && recent.key == key) {
+        seg = recent.seg;
+    } else {
+        if (!served()) return false;
+        {
+            QReadLocker rl(&s_lock);
+            if (!inWindow(jd)) return false;
+            auto it = s_segments.find(key);
+            if (it != s_segments.end()) seg = it->second;
+        }
+        if (!seg) {
+            // fit outside the lock; a racing thread may fit the same
+            // segment, in which case the first one in wins
+            auto fresh = fitSegment(sweNum, flags, sidMode, index);
+            QWriteLocker wl(&s_lock);
+            if (s_generation != gen) return false;
+            seg = s_segments.emplace(key, fresh).first->second;
+        }
+        recent.generation = gen;
+        recent.key = key;
+        recent.seg = seg;
+    }
+
+    if (seg->direct) return false;
+    seg->eval(jd, pos, speed);
+    return true;
+}
+
+/*static*/
+EphemerisCache::Stats
+EphemerisCache::stats()
+{
+    QMutexLocker ml(&s_statsMutex);
+    return s_stats;
+}
+
+/*static*/
+void
+EphemerisCache::resetStats()
+{
+    QMutexLocker ml(&s_statsMutex);
+    s_stats = Stats();
+}
+
+} // namespace A
@@ -0,0 +1,57 @@
+#ifndef A_EPHCACHE_H
+#define A_EPHCACHE_H
+
+#include <QtGlobal>
+
+namespace A {
+
+/// Chebyshev approximations of body longitude and speed, fitted lazily
+/// per segment of time while one or more search windows are open.
+/// Each segment is checked against the direct swe_calc_ut() result at
+/// points between the fit nodes and subdivided until it stays inside
+/// posTolerance/spdTolerance; segments that can't be fit that way fall
+/// back to the direct call.
+class EphemerisCache {
+public:
+    static constexpr double posTolerance = 1e-6;   ///< degrees
+    static constexpr double spdTolerance = 1e-5;   ///< degrees/day
+
+    /// Enables the cache over [jd1, jd2] for the lifetime of the object,
+    /// for the thread that opens it and for every thread other than the
+    /// application's main one; the main thread is only served inside
+    /// windows it has open itself. Fitted segments are dropped when the
+    /// last window goes away.
+    class Window {
+    public:
+        Window(double jd1, double jd2);
+        ~Window();
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
+    private:
+        double _jd1, _jd2;
+    };
+
+    /// Position and speed of sweNum as swe_calc_ut(jd, sweNum, flags)
+    /// would give them, or false if jd is outside every open window or
+    /// the segment is served directly. sidMode is only consulted when
+    /// flags includes SEFLG_SIDEREAL.
+    static bool lookup(int sweNum, int flags, int sidMode,
+                       double jd, double& pos, double& speed);
+
+    struct Stats {
+        quint64 segmentsFit = 0;
+        quint64 segmentsDirect = 0;
+        quint64 sweCalls = 0;     ///< direct calls spent fitting
+        double maxPosError = 0;   ///< worst verified error seen
+        double maxSpdError = 0;
+    };
+
+    static Stats stats();
+    static void resetStats();
+};
+
+} // namespace A
+
+#endif // A_EPHCACHE_H
@@ -7,6 +7,8 @@
 #include <QDebug>
 #include <QStandardPaths>
 #include <QMetaType>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "astro-calc.h"
 #include "astro-gui.h"
@@ -14,6 +16,30 @@
 
 /* ====================== ASTRO FILE ============================= */
 
+namespace {
+
+// changes that only the base harmonic chart depends on
+const AstroFile::Members baseChartMembers =
+        AstroFile::Harmonic | AstroFile::AspectSet | AstroFile::AspectMode;
+
+// what each kind of change means for the horoscope
+A::ChartParts
+chartParts(AstroFile::Members members)
+{
+    A::ChartParts ret;
+    if (members & (AstroFile::GMT | AstroFile::Zodiac))
+        ret |= A::chartPositions;
+    if (members & AstroFile::Location)
+        ret |= A::chartLocation;
+    if (members & AstroFile::HouseSystem)
+        ret |= A::chartHouses;
+    if (members & baseChartMembers)
+        ret |= A::chartHarmonic;
+    return ret;
+}
+
+} // anonymous-namespace
+
 /*static*/ int AstroFile::counter = 0;
 
 AstroFile::AstroFile(QObject* parent) : QObject(parent)
@@ -26,6 +52,8 @@ AstroFile::AstroFile(QObject* parent) : QObject(parent)
     _unsavedChanges = false;
     _holdUpdate = false;
     _holdUpdateMembers = None;
+    _calcMembers = None;
+    _calcBaseChanges = None;
     qDebug() << "Created file" << getName();
 }
 
@@ -251,9 +279,19 @@ AstroFile::change(AstroFile::Members members,
     if (unsavedBefore != _unsavedChanges) members |= ChangedState;
 
     if (!_holdUpdate) {
-        if (members & (GMT | Location | HouseSystem | Zodiac | AspectSet | AspectMode))
-            recalculate();
-        else if (members & Harmonic) {
+        // the run in flight took its harmonic and aspects from before
+        if (_calcRunning) _calcBaseChanges |= members & baseChartMembers;
+
+        if (members & (GMT | Location | HouseSystem | Zodiac)) {
+            if (_background) {
+                // changed() waits for the horoscope
+                ++_calcRequested;
+                _calcMembers |= members;
+                startCalculation();
+                return;
+            }
+            recalculate(members);
+        } else if (members & baseChartMembers) {
             recalculateBaseChart();
         }
 
@@ -397,7 +435,78 @@ void
 AstroFile::recalculate()
 {
     qDebug() << "Calculating file" << getName() << "...";
-    scope = A::calculateAll(scope.inputData);
+    scope = A::HoroscopeCache::calculate(scope.inputData);
+    _calcShown = ++_calcRequested;  // anything in flight is older
+}
+
+void
+AstroFile::recalculate(Members members)
+{
+    qDebug() << "Recalculating file" << getName() << "...";
+    A::recalculate(scope, chartParts(members));
+    _calcShown = ++_calcRequested;
+}
+
+void
+AstroFile::startCalculation()
+{
+    // One at a time: whatever comes in meanwhile waits for the next
+    // run, which takes the input as it is by then.
+    if (_calcRunning) return;
+    _calcRunning = true;
+
+    quint64 generation = _calcRequested;
+    Members members = _calcMembers;
+    _calcMembers = None;
+    _calcBaseChanges = None;
+    qDebug() << "Calculating file" << getName()
+             << "in background, generation" << generation;
+
+    // Only what the changes touch is redone, starting from the chart
+    // as it is; the rest of what differs from the input is pending.
+    A::Horoscope start = scope;
+    A::ChartParts parts = chartParts(members);
+    A::aspectModeEnum mode = A::aspectMode;   // not to be read off-thread
+    auto watcher = new QFutureWatcher<A::Horoscope>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this,
+            [this, watcher, generation, members]
+    {
+        watcher->deleteLater();
+        finishCalculation(generation, members, watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run([start, parts, mode] {
+        A::AspectFinder::prepThread();
+        A::Horoscope ret = start;
+        A::recalculate(ret, parts, mode);
+        return ret;
+    }));
+}
+
+void
+AstroFile::finishCalculation(quint64 generation,
+                             Members members,
+                             const A::Horoscope& result)
+{
+    _calcRunning = false;
+    Members baseChanges = _calcBaseChanges;
+    _calcBaseChanges = None;
+    if (generation > _calcShown) {
+        // the input may have moved on meanwhile; the next run has it,
+        // but a new harmonic or aspect set or mode only needs the base
+        // chart redone, which nothing else will do
+        A::InputData input = scope.inputData;
+        double harmonic = scope.harmonic;
+        scope = result;
+        scope.inputData = input;
+        if (baseChanges || scope.harmonic != harmonic) {
+            scope.harmonic = harmonic;
+            A::calculateBaseChartHarmonic(scope);
+        }
+        _calcShown = generation;
+    }   // else a synchronous recalculate() got there first
+
+    if (_calcRequested > _calcShown) startCalculation();
+    emit changed(members);
 }
 
 void
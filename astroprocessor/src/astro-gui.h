@@ -119,6 +119,13 @@ public:
 
     void             calculate() { recalculate(); }
 
+    /// With this on, the recalculations that changes call for run on a
+    /// worker thread, and changed() goes out, with the members that
+    /// waited on them, once the new horoscope is in. Changes made while
+    /// one runs are coalesced into a single run on the latest input.
+    void setCalculateInBackground(bool b = true) { _background = b; }
+    bool isCalculating() const { return _calcRunning; }
+
     const A::InputData& data() const { return scope.inputData; }
 
     static void      addChartDir(const QString& label,
@@ -167,7 +174,19 @@ private:
 
     A::PlanetSet _focalPlanets;
 
+    bool _background = false;
+    bool _calcRunning = false;
+    quint64 _calcRequested = 0;     // generation of the latest input
+    quint64 _calcShown = 0;         // generation scope was calculated for
+    Members _calcMembers;           // changes waiting on the calculation
+    Members _calcBaseChanges;       // base chart changes made meanwhile
+
+    void startCalculation();
+    void finishCalculation(quint64 generation, Members members,
+                           const A::Horoscope& result);
+
     virtual void recalculate();
+    void recalculate(Members members);
     void recalculateBaseChart();
     void recalculateHarmonics();
     void change(AstroFile::Members, bool affectChangedState = true);
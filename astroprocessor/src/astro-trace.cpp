@@ -0,0 +1,202 @@
+#include <QMutex>
+#include <QThread>
+#include <QDebug>
+
+#include <deque>
+#include <list>
+#include <vector>
+
+#include "astro-trace.h"
+
+namespace A {
+
+namespace {
+
+struct traceRecord {
+    TraceLevel level = traceNone;
+    const char* fmt = nullptr;
+    unsigned char nargs = 0;
+    Trace::Arg args[Trace::maxArgs];
+    ChartPlanetId planets[Trace::maxPlanets];
+
+    QString toString() const;
+};
+
+QString
+traceRecord::toString() const
+{
+    QString ret(fmt);
+    for (unsigned a = 0; a < nargs; ++a) {
+        const auto& arg = args[a];
+        switch (arg.kind()) {
+        case Trace::Arg::integer:
+            ret = ret.arg(arg.integerValue());
+            break;
+        case Trace::Arg::real:
+            ret = ret.arg(arg.realValue());
+            break;
+        case Trace::Arg::julianDay:
+            ret = ret.arg(dtToString(dateTimeFromJulian(arg.realValue())));
+            break;
+        case Trace::Arg::text:
+            ret = ret.arg(QString(arg.textValue()));
+            break;
+        case Trace::Arg::planets: {
+            // offset, count and truncation packed by Trace::push()
+            auto v = arg.integerValue();
+            unsigned off = v & 0xff, n = (v >> 8) & 0xff;
+            PlanetSet ps(planets + off, planets + off + n);
+            auto names = ps.names().join("=");
+            if (v >> 16) names += "=...";
+            ret = ret.arg(names);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return ret;
+}
+
+QStringList
+dumpRecords(const std::vector<traceRecord>& recs, quint64 written)
+{
+    QStringList ret;
+    quint64 from = written > recs.size()? written - recs.size() : 0;
+    for (quint64 r = from; r < written; ++r) {
+        ret << recs[r % recs.size()].toString();
+    }
+    return ret;
+}
+
+struct traceRing;
+
+// what's left of threads that have finished, e.g., pool threads that
+// expired before anyone asked for a dump; the latest few are kept
+struct retiredRing {
+    Qt::HANDLE thread;
+    std::vector<traceRecord> recs;
+    quint64 written;
+};
+constexpr unsigned maxRetired = 32;
+
+QMutex s_ringsMutex;
+std::list<traceRing*> s_rings;
+std::deque<retiredRing> s_retired;
+
+struct traceRing {
+    QMutex mutex;       // only ever contended by a dump
+    std::vector<traceRecord> recs;
+    quint64 written = 0;
+    Qt::HANDLE thread;
+
+    traceRing() : recs(Trace::ringSize), thread(QThread::currentThreadId())
+    {
+        QMutexLocker ml(&s_ringsMutex);
+        s_rings.push_back(this);
+    }
+
+    ~traceRing()
+    {
+        QMutexLocker ml(&s_ringsMutex);
+        s_rings.remove(this);
+        if (!written) return;
+        s_retired.push_back({ thread, std::move(recs), written });
+        if (s_retired.size() > maxRetired) s_retired.pop_front();
+    }
+
+    QStringList dump()
+    {
+        QMutexLocker ml(&mutex);
+        return dumpRecords(recs, written);
+    }
+};
+
+thread_local traceRing st_ring;
+
+thread_local int st_echoLevel = A_TRACE_ECHO;
+
+} // anonymous-namespace
+
+/*static*/
+int&
+Trace::echoLevel()
+{ return st_echoLevel; }
+
+/*static*/
+void
+Trace::push(TraceLevel level, const char* fmt,
+            const Arg* args, unsigned nargs)
+{
+    auto& ring = st_ring;
+    QMutexLocker ml(&ring.mutex);
+    auto& rec = ring.recs[ring.written++ % ring.recs.size()];
+    rec.level = level;
+    rec.fmt = fmt;
+    rec.nargs = static_cast<unsigned char>(qMin(nargs, maxArgs));
+
+    unsigned np = 0;
+    for (unsigned a = 0; a < rec.nargs; ++a) {
+        rec.args[a] = args[a];
+        auto kind = args[a].kind();
+        if (kind != Arg::planet && kind != Arg::planets) continue;
+
+        // copy the planets now; they won't outlive the caller
+        unsigned off = np;
+        bool more = false;
+        auto add = [&](const ChartPlanetId& cpid) {
+            if (np == maxPlanets) more = true;
+            else rec.planets[np++] = cpid;
+        };
+        if (kind == Arg::planet) add(*args[a]._u.id);
+        else for (const auto& cpid: *args[a]._u.ps) add(cpid);
+
+        rec.args[a]._kind = Arg::planets;
+        rec.args[a]._u.i = qint64(off) | qint64(np - off) << 8
+                | qint64(more) << 16;
+    }
+
+#ifndef QT_NO_DEBUG_OUTPUT
+    if (level <= st_echoLevel) {
+        qDebug() << rec.toString().toStdString().c_str();
+    }
+#endif
+}
+
+/*static*/
+QStringList
+Trace::dump()
+{ return st_ring.dump(); }
+
+/*static*/
+QStringList
+Trace::dumpAll()
+{
+    QStringList ret;
+    QMutexLocker ml(&s_ringsMutex);
+    for (const auto& ring: s_retired) {
+        ret << QString("Thread %1 (finished):")
+               .arg(quintptr(ring.thread), 0, 16);
+        for (const auto& rec: dumpRecords(ring.recs, ring.written)) {
+            ret << "  " + rec;
+        }
+    }
+    for (auto ring: s_rings) {
+        auto recs = ring->dump();
+        if (recs.isEmpty()) continue;
+        ret << QString("Thread %1:").arg(quintptr(ring->thread), 0, 16);
+        for (const auto& rec: recs) ret << "  " + rec;
+    }
+    return ret;
+}
+
+/*static*/
+void
+Trace::clear()
+{
+    auto& ring = st_ring;
+    QMutexLocker ml(&ring.mutex);
+    ring.written = 0;
+}
+
+} // namespace A
@@ -0,0 +1,131 @@
+#ifndef A_TRACE_H
+#define A_TRACE_H
+
+#include <QString>
+#include <QStringList>
+#include <type_traits>
+#include <utility>
+#include "astro-data.h"
+
+/// Trace records from the finder loops.
+///
+/// A_TRACE(level, fmt, args...) keeps a record of fmt ("%1"-style, and
+/// it must be a literal) and its raw arguments in a ring buffer owned
+/// by the calling thread. Nothing is formatted until the record is
+/// echoed or dumped, so julian days, planet sets and such are stored as
+/// is. Records above A_TRACE_LEVEL compile away entirely, arguments
+/// and all, and only those up to A_TRACE_ECHO are echoed as they come.
+/// qmake defines QT_NO_DEBUG for release builds, which keep warnings
+/// and echo nothing.
+
+namespace A {
+
+enum TraceLevel {
+    traceNone,
+    traceWarning,   ///< failures worth knowing about
+    traceInfo,      ///< events found, searches launched
+    traceDetail     ///< per-step and per-iteration chatter
+};
+
+} // namespace A
+
+#ifndef A_TRACE_LEVEL
+#if defined(_ZOD_DEBUG)
+#define A_TRACE_LEVEL A::traceDetail
+#elif defined(QT_NO_DEBUG) || defined(NDEBUG)
+#define A_TRACE_LEVEL A::traceWarning
+#else
+#define A_TRACE_LEVEL A::traceInfo
+#endif
+#endif
+
+#ifndef A_TRACE_ECHO
+#if defined(QT_NO_DEBUG) || defined(QT_NO_DEBUG_OUTPUT)
+#define A_TRACE_ECHO A::traceNone
+#else
+#define A_TRACE_ECHO A::traceInfo
+#endif
+#endif
+
+#define A_TRACE(level, ...) \
+    do { \
+        if ((level) <= A_TRACE_LEVEL) A::Trace::record((level), __VA_ARGS__); \
+    } while (0)
+
+namespace A {
+
+class Trace {
+public:
+    /// wrap a julian day so it gets formatted as a date
+    struct JulianDay { double jd; };
+    static JulianDay jd(double jd) { return { jd }; }
+
+    static constexpr unsigned ringSize = 512;
+    static constexpr unsigned maxArgs = 8;
+    static constexpr unsigned maxPlanets = 8;
+
+    class Arg {
+    public:
+        enum Kind : unsigned char { none, integer, real, julianDay, text,
+                                    planet, planets };
+
+        Arg() : _kind(none) { }
+        template <typename T,
+                  typename = std::enable_if_t<std::is_integral<T>::value>>
+        Arg(T i) : _kind(integer) { _u.i = qint64(i); }
+        Arg(double d) : _kind(real) { _u.d = d; }
+        Arg(JulianDay jd) : _kind(julianDay) { _u.d = jd.jd; }
+        Arg(const char* s) : _kind(text) { _u.s = s; }
+        Arg(const ChartPlanetId& id) : _kind(planet) { _u.id = &id; }
+        Arg(const PlanetSet& ps) : _kind(planets) { _u.ps = &ps; }
+
+        Kind kind() const { return _kind; }
+        qint64 integerValue() const { return _u.i; }
+        double realValue() const { return _u.d; }
+        const char* textValue() const { return _u.s; }
+
+    private:
+        friend class Trace;
+        Kind _kind;
+        union {
+            qint64 i;
+            double d;
+            const char* s;
+            const ChartPlanetId* id;    // these two only until copied
+            const PlanetSet* ps;        // into the record
+        } _u;
+    };
+
+    /// Tracing at or below this level is also sent to qDebug() as it
+    /// happens, in builds with debug output. Per thread, starting at
+    /// A_TRACE_ECHO.
+    static int& echoLevel();
+
+    template <typename... Args>
+    static void record(TraceLevel level, const char* fmt, Args&&... args)
+    {
+        static_assert(sizeof...(Args) <= maxArgs, "too many trace arguments");
+        Arg a[] = { Arg(std::forward<Args>(args))..., Arg() };
+        push(level, fmt, a, sizeof...(Args));
+    }
+
+    /// Formatted records from the calling thread's ring, oldest first.
+    static QStringList dump();
+
+    /// Formatted records from every thread that has traced anything,
+    /// grouped by thread. The last few threads to finish are kept, so a
+    /// search's pool threads can still be dumped after it's done; see
+    /// zodiac-events --trace.
+    static QStringList dumpAll();
+
+    /// Drop the calling thread's records.
+    static void clear();
+
+private:
+    static void push(TraceLevel level, const char* fmt,
+                     const Arg* args, unsigned nargs);
+};
+
+} // namespace A
+
+#endif // A_TRACE_H
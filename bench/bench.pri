@@ -0,0 +1,3 @@
+SOURCES += src/main.cpp
+
+include(../cli/cli.pri)
@@ -0,0 +1,10 @@
+#-------------------------------------------------
+#
+# Timings for the calculation and search routines
+#
+#-------------------------------------------------
+
+TARGET = zodiac-bench
+TEMPLATE = app
+DESTDIR = $$_PRO_FILE_PWD_/../bin
+include(bench.pri)
@@ -0,0 +1,7 @@
+SOURCES += main.cpp \
+    window-sweep.cpp \
+    delta-candidates.cpp
+
+HEADERS += checks.h
+
+include(../../cli/cli.pri)
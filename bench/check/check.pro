@@ -0,0 +1,10 @@
+#-------------------------------------------------
+#
+# Checks of the search routines against the code they replaced
+#
+#-------------------------------------------------
+
+TARGET = zodiac-check
+TEMPLATE = app
+DESTDIR = $$_PRO_FILE_PWD_/../../bin
+include(check.pri)
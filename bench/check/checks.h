@@ -0,0 +1,12 @@
+#ifndef CHECKS_H
+#define CHECKS_H
+
+class QTextStream;
+
+// Each check runs its cases, says what differed on err and returns how
+// many cases did.
+
+unsigned checkWindowSweep(unsigned trials, QTextStream& err);
+unsigned checkDeltaCandidates(unsigned trials, QTextStream& err);
+
+#endif // CHECKS_H
@@ -0,0 +1,83 @@
+#include <QTextStream>
+#include <Astroprocessor/Calc>
+#include "checks.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Checks that harmonicDeltaCandidates(), vectorized however the library
+// was built, flags the same pairs as its scalar path. The pairs are
+// random, but many sit right on the edges the test turns on: contact,
+// deltaSlop either side of it, the 90-degree cutoff and opposition,
+// and bodies either side of 0 Aries.
+
+namespace {
+
+const double s_edges[] = {
+    0, A::harmonicDeltaSlop, -A::harmonicDeltaSlop,
+    90, -90, 90 + A::harmonicDeltaSlop, -90 - A::harmonicDeltaSlop,
+    180, -180, 360
+};
+
+} // anonymous-namespace
+
+unsigned
+checkDeltaCandidates(unsigned trials, QTextStream& err)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<> where(0, 360), tiny(-1e-6, 1e-6);
+    const unsigned numEdges = sizeof(s_edges) / sizeof(s_edges[0]);
+
+    // a body anywhere, or just either side of 0 Aries
+    auto body = [&]() {
+        if (gen() % 4) return where(gen);
+        double d = std::abs(tiny(gen));
+        return gen() % 2 ? 360 - d : d;
+    };
+    // a delta on an edge, just off one, or anything
+    auto delta = [&]() {
+        switch (gen() % 3) {
+        case 0: return s_edges[gen() % numEdges];
+        case 1: return s_edges[gen() % numEdges] + tiny(gen);
+        default: return where(gen);
+        }
+    };
+
+    unsigned checked = 0, bad = 0;
+    std::vector<double> ai, aj, bi, bj;
+    std::vector<unsigned char> vec, one;
+    for (unsigned t = 0; t < trials; ++t) {
+        // odd counts too, for the tail past the last full vector
+        unsigned n = 1 + gen() % 37;
+        unsigned h = 1 + gen() % 32;
+        ai.resize(n); aj.resize(n); bi.resize(n); bj.resize(n);
+        for (unsigned k = 0; k < n; ++k) {
+            // placed so the delta at harmonic h is about the one chosen
+            ai[k] = body();
+            aj[k] = fmod(ai[k] + delta() / h + 360, 360.);
+            bi[k] = body();
+            bj[k] = fmod(bi[k] + delta() / h + 360, 360.);
+        }
+        vec.assign(n, 2);
+        one.assign(n, 2);
+        A::harmonicDeltaCandidates(n, h, ai.data(), aj.data(),
+                                   bi.data(), bj.data(), vec.data());
+        A::harmonicDeltaCandidatesScalar(n, h, ai.data(), aj.data(),
+                                         bi.data(), bj.data(), one.data());
+        for (unsigned k = 0; k < n; ++k, ++checked) {
+            if (vec[k] == one[k]) continue;
+            if (++bad <= 10) {
+                err << QString("H%1 %2-%3 then %4-%5: vector %6, scalar %7\n")
+                       .arg(h)
+                       .arg(ai[k], 0, 'g', 17).arg(aj[k], 0, 'g', 17)
+                       .arg(bi[k], 0, 'g', 17).arg(bj[k], 0, 'g', 17)
+                       .arg(int(vec[k])).arg(int(one[k]));
+            }
+        }
+    }
+
+    err << "harmonicDeltaCandidates: " << bad << " of " << checked
+        << " pairs differ\n";
+    return bad;
+}
@@ -0,0 +1,37 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include "cli.h"
+#include "checks.h"
+
+// Checks of the search routines against the code they replaced, or
+// against their own slower paths. Returns 1 if anything differs.
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("zodiac-check");
+    a.setApplicationVersion("v0.8.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Check the search routines against "
+                                     "the code they replaced.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption trialsOpt({"n", "trials"}, "Random cases for each "
+                                 "check (default 2000).", "n", "2000");
+    parser.addOption(trialsOpt);
+    addToolOptions(parser);
+    parser.process(a);
+
+    bool ok = false;
+    unsigned trials = parser.value(trialsOpt).toUInt(&ok);
+    if (!ok) return toolFail("bad --trials");
+    if (!setUpTool(parser)) return 1;
+
+    QTextStream err(stderr);
+    unsigned bad = checkDeltaCandidates(trials * 10, err);
+    bad += checkWindowSweep(trials, err);
+    return bad ? 1 : 0;
+}
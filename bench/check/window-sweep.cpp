@@ -0,0 +1,367 @@
+#include <QThread>
+#include <QThreadPool>
+#include <QTextStream>
+#include <Astroprocessor/Calc>
+#include "checks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <random>
+#include <set>
+#include <vector>
+
+// Checks findHarmonics() against the PlanetRange/PlanetQueue sweep it
+// replaced, on real charts and on random ones with tied longitudes and
+// bodies either side of 0 Aries. It's run on the whole thread pool and
+// then a harmonic at a time, and the three have to agree on every group
+// and every position in it.
+//
+// The reference below is the old findHarmonics() taking its settings
+// from a HarmonicContext; keep it as it is unless the groups are meant
+// to change.
+
+namespace {
+
+qreal
+position(const A::Planet& p, A::aspectModeEnum mode)
+{
+    if (mode == A::amcEcliptic) return p.eclipticPos.x();
+    if (mode == A::amcEquatorial) return p.equatorialPos.x();
+    return p.pvPos;
+}
+
+bool
+meetsQuorum(const A::PlanetQueue& curr,
+            const std::set<int>& needs,
+            unsigned quorum)
+{
+    std::map<int, int> counts;
+    unsigned q = 0;
+    for (const A::PlanetLoc& pl : curr) {
+        int n = pl.planet.isSolo() ? 1 : 2;
+        q += n, counts[pl.planet.fileId()] += n;
+    }
+    if (q < quorum) return false;
+    for (int need : needs) {
+        if (counts[need] == 0) return false;
+    }
+    return true;
+}
+
+bool
+outOfOrb(const A::PlanetLoc& a, const A::PlanetLoc& b, double orb)
+{ return A::angle(a.loc, b.loc) > orb; }
+
+// as ChartPlanetBitmap::contains(): a chart lower has none of is no matter
+bool
+covers(const A::PlanetSet& lower, const A::PlanetSet& ps)
+{
+    for (const auto& cpid : ps) {
+        if (lower.count(cpid)) continue;
+        for (const auto& l : lower) {
+            if (l.fileId() == cpid.fileId()) return false;
+        }
+    }
+    return true;
+}
+
+void
+referenceHarmonics(const A::ChartPlanetMap& cpm,
+                   A::PlanetHarmonics& hx,
+                   const A::HarmonicContext& ctx)
+{
+    std::set<int> needsFiles;
+    for (const auto& cpid : cpm.keys()) needsFiles.insert(cpid.fileId());
+
+    auto computePositions = [&](unsigned h,
+                                A::PlanetRange& allOfThem,
+                                bool doMidpoints)
+    {
+        auto at = [&](const A::Planet& p) {
+            qreal loc = position(p, ctx.aspectMode);
+            return h > 1 ? fmod(loc * h, 360.) : loc;
+        };
+        for (auto cpit = cpm.cbegin(); cpit != cpm.cend(); ++cpit) {
+            qreal loc = at(cpit.value());
+            allOfThem.insert(A::PlanetLoc(cpit.key(), loc));
+
+            if (!doMidpoints) continue;
+
+            for (auto cpot = std::next(cpit);
+                 cpot != cpm.cend()
+                 && cpit.key().fileId() == cpot.key().fileId();
+                 ++cpot)
+            {
+                qreal loc1 = loc;
+                qreal loc2 = at(cpot.value());
+                if (loc1 > loc2) qSwap(loc1, loc2);
+                if (loc2 - loc1 > 180) loc1 += 360;
+                loc2 = fmod((loc1 + loc2) / 2, 360.);
+
+                allOfThem.insert(A::PlanetLoc(cpit.key().fileId(),
+                                              cpit.key().planetId(),
+                                              cpot.key().planetId(), loc2));
+                allOfThem.insert(A::PlanetLoc(cpit.key().fileId(),
+                                              cpot.key().planetId(),
+                                              cpit.key().planetId(),
+                                              fmod(loc2 + 180, 360.)));
+            }
+        }
+    };
+
+    auto cluster = [&](A::PlanetGroups& groups,
+                       unsigned quorum, qreal orb,
+                       const A::PlanetRange& allOfThem)
+    {
+        A::PlanetQueue current;
+        A::PlanetLoc last;
+        if (!outOfOrb(*allOfThem.crbegin(), *allOfThem.cbegin(), orb)) {
+            auto next = allOfThem.crbegin();
+            do {
+                last = *next;
+                current.push_front(last);
+            } while (++next != allOfThem.crend()
+                     && !outOfOrb(*allOfThem.cbegin(), *next, orb));
+        } else {
+            last = *allOfThem.cbegin();
+        }
+        current.push_back(*allOfThem.cbegin());
+        for (auto plit = allOfThem.cbegin(); ++plit != allOfThem.cend(); ) {
+            const auto& pl = *plit;
+            if (outOfOrb(pl, last, orb)) {
+                if (meetsQuorum(current, needsFiles, quorum)) {
+                    groups.insert(current, ctx.minQuorum, ctx.requireAnchor);
+                }
+                do {
+                    current.pop_front();
+                    if (current.empty()) {
+                        last = pl;
+                        break;
+                    }
+                    last = *current.cbegin();
+                } while (outOfOrb(pl, last, orb));
+            }
+            current.push_back(pl);
+        }
+        if (meetsQuorum(current, needsFiles, quorum)) {
+            groups.insert(current, ctx.minQuorum, ctx.requireAnchor);
+        }
+    };
+
+    std::vector<std::vector<A::PlanetSet>> seen(ctx.maxHarmonic + 1);
+    for (unsigned h : ctx.harmonics) {
+        A::PlanetGroups groups;
+        A::PlanetRange allOfThem;
+        if (ctx.includeMidpoints) {
+            computePositions(h, allOfThem, true);
+            for (const auto& pass : ctx.passes) {
+                cluster(groups, pass.quorum, pass.orb / 10, allOfThem);
+            }
+            allOfThem.clear();
+        }
+        computePositions(h, allOfThem, false);
+        for (const auto& pass : ctx.passes) {
+            cluster(groups, pass.quorum, pass.orb, allOfThem);
+        }
+
+        bool prime = ctx.primeSieve[h];
+        if (prime) hx[h] = groups;
+        for (const auto& g : groups) {
+            if (!g.first.containsMidPt()) {
+                bool found = false;
+                for (unsigned lh : ctx.factors[h]) {
+                    for (const auto& lower : seen[lh]) {
+                        if ((found = covers(lower, g.first))) break;
+                    }
+                    if (found) break;
+                }
+                if (!prime && found) continue;
+                seen[h].push_back(g.first);
+            }
+            if (!prime) hx[h].insert(g);
+        }
+    }
+    for (auto it = hx.begin(); it != hx.end();) {
+        if (it->second.empty()) hx.erase(it++); else ++it;
+    }
+}
+
+QString
+names(const A::PlanetSet& ps)
+{
+    QStringList sl;
+    for (const auto& cpid : ps) {
+        sl << QString("%1:%2").arg(cpid.fileId()).arg(cpid.name());
+    }
+    return sl.join("=");
+}
+
+// The first difference between a and b, or an empty string.
+QString
+compare(const A::PlanetHarmonics& a, const A::PlanetHarmonics& b)
+{
+    for (const auto& ha : a) {
+        auto hb = b.find(ha.first);
+        if (hb == b.end()) return QString("H%1 missing").arg(ha.first);
+        for (const auto& ga : ha.second) {
+            auto gb = hb->second.find(ga.first);
+            if (gb == hb->second.end()) {
+                return QString("H%1 %2 missing").arg(ha.first)
+                        .arg(names(ga.first));
+            }
+            auto pa = ga.second.cbegin();
+            auto pb = gb->second.cbegin();
+            for (; pa != ga.second.cend() && pb != gb->second.cend();
+                 ++pa, ++pb)
+            {
+                if (pa->planet < pb->planet || pb->planet < pa->planet
+                        || std::abs(pa->loc - pb->loc) > 1e-9)
+                {
+                    return QString("H%1 %2 placed differently").arg(ha.first)
+                            .arg(names(ga.first));
+                }
+            }
+            if (ga.second.size() != gb->second.size()) {
+                return QString("H%1 %2 sized differently").arg(ha.first)
+                        .arg(names(ga.first));
+            }
+        }
+        if (ha.second.size() != hb->second.size()) {
+            return QString("H%1 has extra groups").arg(ha.first);
+        }
+    }
+    if (a.size() != b.size()) return "extra harmonics";
+    return QString();
+}
+
+A::Planet
+placed(qreal loc)
+{
+    A::Planet p;
+    p.eclipticPos = QPointF(loc, 0);
+    p.equatorialPos = QPointF(loc, 0);
+    p.pvPos = loc;
+    return p;
+}
+
+// Up to 17 bodies in each of one or two charts: some share a longitude
+// with a body before them, and some sit just either side of 0 Aries.
+A::ChartPlanetMap
+randomChart(std::mt19937& gen)
+{
+    static const A::PlanetId s_bodies[] = {
+        A::Planet_Sun, A::Planet_Moon, A::Planet_Mercury, A::Planet_Venus,
+        A::Planet_Mars, A::Planet_Jupiter, A::Planet_Saturn,
+        A::Planet_Uranus, A::Planet_Neptune, A::Planet_Pluto,
+        A::Planet_NorthNode, A::Planet_Chiron, A::Planet_Ceres,
+        A::Planet_Pallas, A::Planet_Juno, A::Planet_Asc, A::Planet_MC
+    };
+    const unsigned numBodies = sizeof(s_bodies) / sizeof(s_bodies[0]);
+    std::uniform_real_distribution<> where(0, 360), nudge(-.5, .5);
+
+    A::ChartPlanetMap cpm;
+    std::vector<qreal> locs;
+    int files = 1 + int(gen() % 2);
+    for (int fid = 0; fid < files; ++fid) {
+        unsigned n = 3 + gen() % (numBodies - 2);
+        std::vector<A::PlanetId> ids(std::begin(s_bodies),
+                                     std::end(s_bodies));
+        std::shuffle(ids.begin(), ids.end(), gen);
+        for (unsigned i = 0; i < n; ++i) {
+            qreal loc;
+            switch (gen() % 6) {
+            case 0:
+                if (!locs.empty()) {
+                    loc = locs[gen() % locs.size()];
+                    break;
+                }
+                // fall through
+            case 1:
+                loc = fmod(360 + nudge(gen), 360.);
+                break;
+            default:
+                loc = where(gen);
+                break;
+            }
+            locs.push_back(loc);
+            cpm.insert(A::ChartPlanetId(fid, ids[i], A::Planet_None),
+                       placed(loc));
+        }
+    }
+    return cpm;
+}
+
+A::ChartPlanetMap
+realChart(const QDateTime& gmt, const QVector3D& where, int fid = 0)
+{
+    auto scope = A::calculateAll(A::InputData(gmt, 0, where));
+    return scope.getOrigChartPlanets(fid);
+}
+
+} // anonymous-namespace
+
+unsigned
+checkWindowSweep(unsigned trials, QTextStream& err)
+{
+    auto pool = QThreadPool::globalInstance();
+    int threads = QThread::idealThreadCount();
+    unsigned checked = 0, bad = 0;
+
+    auto check = [&](const QString& what,
+                     const A::ChartPlanetMap& cpm,
+                     const A::HarmonicContext& ctx)
+    {
+        A::PlanetHarmonics ref, all, one;
+        referenceHarmonics(cpm, ref, ctx);
+        pool->setMaxThreadCount(threads);
+        A::findHarmonics(cpm, all, ctx);
+        pool->setMaxThreadCount(1);
+        A::findHarmonics(cpm, one, ctx);
+        pool->setMaxThreadCount(threads);
+
+        ++checked;
+        QString diff = compare(ref, all);
+        if (diff.isEmpty()) diff = compare(all, ref);
+        if (diff.isEmpty()) diff = compare(all, one);
+        if (diff.isEmpty()) diff = compare(one, all);
+        if (diff.isEmpty()) return;
+        if (++bad <= 10) err << what << ": " << diff << "\n";
+    };
+
+    A::HarmonicContext base;
+    for (bool midpoints : { false, true }) {
+        auto ctx = base;
+        ctx.includeMidpoints = midpoints;
+        ctx.aspectMode = A::amcEcliptic;
+        QVector3D greenwich(-0.0015f, 51.4779f, 0);
+        QDateTime natal(QDate(1967, 3, 21), QTime(5, 45), Qt::UTC);
+        QDateTime transit(QDate(2020, 6, 1), QTime(0, 0), Qt::UTC);
+        auto cpm = realChart(natal, greenwich);
+        check(QString("natal, midpoints %1").arg(midpoints), cpm, ctx);
+        auto both = cpm;
+        auto trans = realChart(transit, greenwich, 1);
+        for (auto it = trans.cbegin(); it != trans.cend(); ++it) {
+            both.insert(it.key(), it.value());
+        }
+        check(QString("natal and transits, midpoints %1").arg(midpoints),
+              both, ctx);
+    }
+
+    std::mt19937 gen(1);
+    const qreal orbScales[] = { .5, 1, 2, 4 };
+    for (unsigned t = 0; t < trials; ++t) {
+        auto ctx = base;
+        ctx.maxHarmonic = 32;
+        ctx.prepare();
+        ctx.includeMidpoints = gen() % 2;
+        ctx.aspectMode = A::amcEcliptic;
+        qreal scale = orbScales[gen() % 4];
+        for (auto& pass : ctx.passes) pass.orb *= scale;
+        check(QString("random chart %1").arg(t), randomChart(gen), ctx);
+    }
+
+    err << "findHarmonics: " << bad << " of " << checked
+        << " charts differ\n";
+    return bad;
+}
@@ -0,0 +1,370 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <Astroprocessor/Calc>
+#include <Astroprocessor/Gui>
+#include "cli.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Timings of the main calculation and search entry points over a fixed
+// set of charts, date ranges and harmonic sets, written as JSON so two
+// builds can be diffed, or checked against a saved run with --baseline.
+
+namespace {
+
+struct fixture {
+    const char* name;
+    const char* gmt;    ///< ISO, UTC
+    short tz;
+    float lon, lat;
+};
+
+// Arbitrary but fixed: a spread of eras, hemispheres and latitudes.
+const fixture s_charts[] = {
+    { "j2000",      "2000-01-01T12:00:00Z",  0,    -0.0015f, 51.4779f },
+    { "newyork",    "1950-06-15T08:30:00Z", -5,   -74.0060f, 40.7128f },
+    { "sydney",     "1985-11-03T22:10:00Z", 10,   151.2093f, -33.8688f },
+    { "quito",      "1991-07-11T19:00:00Z", -5,   -78.4678f, -0.1807f },
+    { "stockholm",  "1967-03-21T05:45:00Z",  1,    18.0686f, 59.3293f },
+};
+
+// The README's "about a second per year, ~4 s for H1-32" is for one
+// chart and one year of transits; that's what these time.
+const QDate s_searchFrom(2020, 1, 1);
+const QDate s_searchTo(2020, 12, 31);
+
+struct harmonicSet {
+    const char* name;
+    unsigned from, to;
+};
+
+const harmonicSet s_harmonicSets[] = {
+    { "H1",     1, 1 },
+    { "H1-8",   1, 8 },
+    { "H1-32",  1, 32 },
+};
+
+A::InputData
+inputFor(const fixture& fx)
+{
+    return A::InputData(QDateTime::fromString(fx.gmt, Qt::ISODate).toUTC(),
+                        fx.tz, QVector3D(fx.lon, fx.lat, 0));
+}
+
+struct result {
+    QString name;
+    QString fixture;
+    std::vector<double> ms;     ///< per run
+    qint64 count = 0;           ///< events, hits, groups...
+    QString countLabel;
+    bool perSecond = false;     ///< also report count per second
+
+    double min() const { return *std::min_element(ms.begin(), ms.end()); }
+
+    double median() const
+    {
+        auto v = ms;
+        std::sort(v.begin(), v.end());
+        auto n = v.size();
+        return n % 2? v[n/2] : (v[n/2 - 1] + v[n/2]) / 2.;
+    }
+
+    QString key() const { return name + "/" + fixture; }
+
+    QJsonObject toJson() const
+    {
+        QJsonObject obj;
+        obj.insert("name", name);
+        obj.insert("fixture", fixture);
+        obj.insert("runs", int(ms.size()));
+        obj.insert("min_ms", min());
+        obj.insert("median_ms", median());
+        if (!countLabel.isEmpty()) {
+            obj.insert(countLabel, count);
+            if (perSecond && median() > 0) {
+                obj.insert(countLabel + "_per_sec", count / (median() / 1000.));
+            }
+        }
+        return obj;
+    }
+};
+
+/// Time fn, which returns its count, runs times with iters calls each.
+/// The count is from the last call, since they should all agree. One
+/// call of warm, or of fn if there's none, loads the data files and
+/// fills the caches first.
+result
+timeIt(const QString& name, const QString& fixture,
+       unsigned runs, unsigned iters,
+       const std::function<qint64()>& fn,
+       const std::function<qint64()>& warm = nullptr)
+{
+    result ret;
+    ret.name = name;
+    ret.fixture = fixture;
+    if (warm) warm();
+    else fn();
+    for (unsigned r = 0; r < runs; ++r) {
+        QElapsedTimer timer;
+        timer.start();
+        for (unsigned i = 0; i < iters; ++i) ret.count = fn();
+        ret.ms.push_back(double(timer.nsecsElapsed()) / 1e6 / iters);
+    }
+    return ret;
+}
+
+qint64
+omnibus(const A::InputData& natin, const A::uintSSet& hs,
+        const QDate& from = s_searchFrom, const QDate& to = s_searchTo)
+{
+    AstroFile natal;
+    natal.suspendUpdate();
+    natal.setType(TypeMale);
+    natal.setGMT(natin.GMT());
+    natal.setTimezone(natin.tz());
+    natal.setLocation(natin.location());
+    natal.resumeUpdate();
+
+    AstroFile trans;
+    trans.suspendUpdate();
+    trans.setGMT(QDateTime(from, QTime(0, 0), Qt::UTC));
+    trans.setLocation(natin.location());
+    trans.resumeUpdate();
+
+    A::HarmonicEvents evs;
+    A::OmnibusFinder af(evs, { from, to }, hs,
+                        { &natal, &trans });
+    runFinder(af);
+    return qint64(evs.size());
+}
+
+} // anonymous-namespace
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("zodiac-bench");
+    a.setApplicationVersion("v0.8.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Time the calculation and event "
+                                     "search routines and write the "
+                                     "results as JSON.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption runsOpt({"r", "runs"}, "Timed runs of each "
+                               "benchmark (default 3).", "n", "3");
+    QCommandLineOption onlyOpt("only", "Run only the benchmarks whose "
+                               "name/fixture matches this pattern.",
+                               "regexp");
+    QCommandLineOption outOpt({"o", "output"}, "Write here instead of "
+                              "standard output.", "file");
+    QCommandLineOption baseOpt("baseline", "Compare medians against this "
+                               "earlier output and fail on regressions.",
+                               "file");
+    QCommandLineOption tolOpt("tolerance", "Slowdown over the baseline "
+                              "that counts as a regression (default "
+                              "1.25).", "ratio", "1.25");
+    parser.addOptions({ runsOpt, onlyOpt, outOpt, baseOpt, tolOpt });
+    addToolOptions(parser);
+    parser.process(a);
+
+    QTextStream err(stderr);
+
+    bool ok = false;
+    unsigned runs = parser.value(runsOpt).toUInt(&ok);
+    if (!ok || runs == 0) return toolFail("bad --runs");
+    double tolerance = parser.value(tolOpt).toDouble(&ok);
+    if (!ok || tolerance < 1) return toolFail("bad --tolerance");
+
+    QRegularExpression only(parser.value(onlyOpt));
+    if (!only.isValid()) return toolFail("bad --only pattern");
+
+    QString outPath = parser.value(outOpt);
+    QString basePath = parser.value(baseOpt);
+    if (!outPath.isEmpty()) outPath = QFileInfo(outPath).absoluteFilePath();
+    if (!basePath.isEmpty()) basePath = QFileInfo(basePath).absoluteFilePath();
+
+    if (!setUpTool(parser)) return 1;
+
+    std::vector<result> results;
+    auto bench = [&](const QString& name, const QString& fixture,
+                     unsigned iters, const std::function<qint64()>& fn,
+                     const std::function<qint64()>& warm = nullptr)
+            -> result*
+    {
+        if (!QString(name + "/" + fixture).contains(only)) return nullptr;
+        err << name << " " << fixture << "..." << Qt::flush;
+        results.push_back(timeIt(name, fixture, runs, iters, fn, warm));
+        err << " " << results.back().median() << " ms\n";
+        return &results.back();
+    };
+
+    for (const auto& fx : s_charts) {
+        auto input = inputFor(fx);
+        bench("calculateAll", fx.name, 20, [&] {
+            auto scope = A::calculateAll(input);
+            return qint64(scope.planets.size());
+        });
+    }
+
+    for (const auto& fx : s_charts) {
+        auto input = inputFor(fx);
+        A::HoroscopeCache::calculate(input);    // the rest are hits
+        bench("HoroscopeCache", fx.name, 20, [&] {
+            auto scope = A::HoroscopeCache::calculate(input);
+            return qint64(scope.planets.size());
+        });
+    }
+
+    for (const auto& fx : s_charts) {
+        auto scope = A::calculateAll(inputFor(fx));
+        A::ChartPlanetMap cpm;
+        auto apm = scope.getOrigChartPlanets(0);
+        for (auto it = apm.cbegin(); it != apm.cend(); ++it) {
+            auto pid = it.key().planetId();
+            if ((pid >= A::Planet_Sun && pid <= A::Planet_Pluto)
+                    || pid == A::Planet_MC || pid == A::Planet_Asc)
+            {
+                cpm[it.key()] = it.value();
+            }
+        }
+        auto r = bench("findHarmonics", fx.name, 20, [&] {
+            A::PlanetHarmonics hx;
+            A::findHarmonics(cpm, hx);
+            qint64 groups = 0;
+            for (const auto& h : hx) groups += qint64(h.second.size());
+            return groups;
+        });
+        if (r) r->countLabel = "groups";
+    }
+
+    {
+        const auto& fx = s_charts[0];
+        auto natin = inputFor(fx);
+        for (const auto& set : s_harmonicSets) {
+            A::uintSSet hs;
+            for (unsigned h = set.from; h <= set.to; ++h) hs.insert(h);
+            auto r = bench("OmnibusFinder::findStuff",
+                           QString("%1 %2 %3").arg(QString(fx.name),
+                                                   QString(set.name))
+                           .arg(s_searchFrom.year()), 1,
+                           [&] { return omnibus(natin, hs); },
+                           [&] {    // a week's worth is warm enough
+                               return omnibus(natin, hs, s_searchFrom,
+                                              s_searchFrom.addDays(7));
+                           });
+            if (r) r->countLabel = "events", r->perSecond = true;
+        }
+    }
+
+    {
+        // new moons over the search year, as the file editor would look
+        // for them
+        A::InputData locale(QDateTime(s_searchFrom, QTime(0, 0), Qt::UTC),
+                            0, inputFor(s_charts[0]).location());
+        auto newMoons = [&](const QDateTime& end) {
+            A::PlanetProfile poses;
+            poses.push_back(new A::TransitPosition(A::Planet_Sun, locale));
+            poses.push_back(new A::TransitPosition(A::Planet_Moon, locale));
+            double orb, horb, span;
+            A::calculateOrbAndSpan(poses, locale, 1, orb, horb, span);
+            auto hits = A::quotidianSearch(poses, locale, end,
+                                           std::min(span, 30.), false);
+            return qint64(hits.size());
+        };
+        QDateTime end(s_searchTo.addDays(1), QTime(0, 0), Qt::UTC);
+        QDateTime warmEnd(s_searchFrom.addMonths(1), QTime(0, 0), Qt::UTC);
+        auto r = bench("quotidianSearch", "Sun=Moon 2020", 1,
+                       [&] { return newMoons(end); },
+                       [&] { return newMoons(warmEnd); });
+        if (r) r->countLabel = "hits";
+    }
+
+    for (const auto& fx : s_charts) {
+        auto native = inputFor(fx);
+        A::InputData locale(QDateTime(QDate(2020, 6, 1), QTime(0, 0),
+                                      Qt::UTC),
+                            0, native.location());
+        for (auto pid : { A::Planet_Sun, A::Planet_Moon }) {
+            bench("calculateReturnTime",
+                  QString("%1 %2").arg(QString(fx.name),
+                                       A::getPlanet(pid).name), 5, [&] {
+                auto dt = A::calculateReturnTime(pid, native, locale, 1);
+                return qint64(dt.isValid());
+            });
+        }
+    }
+
+    QJsonArray arr;
+    for (const auto& r : results) arr << r.toJson();
+
+    QJsonObject doc;
+    doc.insert("version", a.applicationVersion());
+    doc.insert("qt", QString(qVersion()));
+#ifdef QT_NO_DEBUG
+    doc.insert("build", "release");
+#else
+    doc.insert("build", "debug");
+#endif
+    doc.insert("threads", QThread::idealThreadCount());
+    doc.insert("runs", int(runs));
+    doc.insert("benchmarks", arr);
+
+    QFile outFile;
+    if (!outPath.isEmpty()) {
+        outFile.setFileName(outPath);
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return toolFail("can't write " + outPath);
+        }
+    } else {
+        outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    outFile.write(QJsonDocument(doc).toJson(QJsonDocument::Indented));
+    outFile.close();
+
+    if (basePath.isEmpty()) return 0;
+
+    QFile baseFile(basePath);
+    if (!baseFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return toolFail("can't read " + basePath);
+    }
+    auto base = QJsonDocument::fromJson(baseFile.readAll()).object();
+    QMap<QString, double> baseMs;
+    for (const auto& v : base.value("benchmarks").toArray()) {
+        auto obj = v.toObject();
+        baseMs.insert(obj.value("name").toString() + "/"
+                      + obj.value("fixture").toString(),
+                      obj.value("median_ms").toDouble());
+    }
+
+    int regressions = 0;
+    for (const auto& r : results) {
+        auto was = baseMs.value(r.key());
+        if (was <= 0) continue;
+        double ratio = r.median() / was;
+        bool slow = ratio > tolerance;
+        if (slow) ++regressions;
+        err << (slow? "SLOWER " : "       ") << r.key() << ": "
+            << r.median() << " ms vs " << was << " ms ("
+            << QString::number(ratio, 'f', 2) << "x)\n";
+    }
+    if (regressions) {
+        toolFail(QString("%1 regression(s) past %2x").arg(regressions)
+                 .arg(tolerance));
+        return 3;
+    }
+    return 0;
+}
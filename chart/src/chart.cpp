@@ -433,6 +433,10 @@ Chart::updatePlanetsAndCusps(int fileIndex)
 
     for (const A::Star& s : file(fileIndex)->horoscope().stars) {
         bool hide = !s.isConfiguredWithPlanet();
+        if (!planets[fileIndex].contains(s.id)) {
+            if (hide) continue;
+            drawStar(fileIndex, s);
+        }
         std::tie(body, marker) = repose(s, hide);
         if (hide) continue;
 
@@ -677,49 +681,54 @@ void Chart::drawPlanets(int fileIndex)
 
 void Chart::drawStars(int fileIndex)
 {
-    QFont planetFont("Almagest", 17, QFont::Bold);
-    QFont planetFontSmall("Almagest", 15, QFont::Bold);
+    // Only the stars with a planet on them are shown, so the rest get
+    // their items when they first are; see updatePlanetsAndCusps().
+    for (const auto& star : file(fileIndex)->horoscope().stars) {
+        if (star.isConfiguredWithPlanet()) drawStar(fileIndex, star);
+    }
+}
 
-    QGraphicsScene* s = view->scene();
+void Chart::drawStar(int fileIndex, const A::Star& star)
+{
+    static QFont planetFont("Almagest", 17, QFont::Bold);
 
-    for (const auto& star : file(fileIndex)->horoscope().stars) {
-        int radius = 2;
+    QGraphicsScene* s = view->scene();
+    int radius = 2;
 
-        auto text =
-                s->addSimpleText("*", planetFont);
-        auto marker =
-                s->addEllipse(-innerRadius(fileIndex) - radius, -radius,
-                              radius * 2, radius * 2,
-                              planetMarkerPen(A::Planet(), fileIndex));
-#if 0
-        if (star.isConfiguredWithPlanet())
-            qDebug() << "star " << star.name
-                     << " 'text" << (void*)text
-                     << " 'marker" << (void*)marker;
-#endif
-        if (filesCount() > 1) {
-            // duplicate on outer circle
-            auto e = s->addEllipse(-innerRadius(0) - radius, -radius,
+    auto text =
+            s->addSimpleText("*", planetFont);
+    auto marker =
+            s->addEllipse(-innerRadius(fileIndex) - radius, -radius,
                           radius * 2, radius * 2,
                           planetMarkerPen(A::Planet(), fileIndex));
-            e->setParentItem(marker);
-        }
-
-        text->setPos(normalPlanetPosX(text, marker),
-                     -text->boundingRect().height() / 2);
-        text->setBrush(planetColor(A::Planet(), fileIndex));
-        text->setPen(planetShapeColor(A::Planet(), fileIndex));
-        //text   -> setOpacity(opacity);
-        text->setTransformOriginPoint(text->boundingRect().center());
-        text->setParentItem(marker);
-        text->setData(1, star.name);    // remember PlanetId for clicking on item
-        text->setData(2, fileIndex);    // remember fileIndex
-        marker->setTransformOriginPoint(circle->boundingRect().center());
-        marker->setZValue(1);
-
-        planets[fileIndex][star.id] = text;
-        planetMarkers[fileIndex][star.id] = marker;
+#if 0
+    if (star.isConfiguredWithPlanet())
+        qDebug() << "star " << star.name
+                 << " 'text" << (void*)text
+                 << " 'marker" << (void*)marker;
+#endif
+    if (filesCount() > 1) {
+        // duplicate on outer circle
+        auto e = s->addEllipse(-innerRadius(0) - radius, -radius,
+                               radius * 2, radius * 2,
+                               planetMarkerPen(A::Planet(), fileIndex));
+        e->setParentItem(marker);
     }
+
+    text->setPos(normalPlanetPosX(text, marker),
+                 -text->boundingRect().height() / 2);
+    text->setBrush(planetColor(A::Planet(), fileIndex));
+    text->setPen(planetShapeColor(A::Planet(), fileIndex));
+    //text   -> setOpacity(opacity);
+    text->setTransformOriginPoint(text->boundingRect().center());
+    text->setParentItem(marker);
+    text->setData(1, star.name);    // remember PlanetId for clicking on item
+    text->setData(2, fileIndex);    // remember fileIndex
+    marker->setTransformOriginPoint(circle->boundingRect().center());
+    marker->setZValue(1);
+
+    planets[fileIndex][star.id] = text;
+    planetMarkers[fileIndex][star.id] = marker;
 }
 
 void
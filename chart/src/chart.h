@@ -85,6 +85,7 @@ private:
 
     void drawPlanets(int fileIndex);
     void drawStars(int fileIndex);
+    void drawStar(int fileIndex, const A::Star& star);
     void drawCuspides(int fileIndex);
     void updatePlanetsAndCusps(int fileIndex);
     void updateAspects();
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# What the command-line tools have in common
+#
+#-------------------------------------------------
+
+QT += widgets concurrent
+CONFIG += console
+CONFIG -= app_bundle
+
+# library dependencies
+LIBS += -L$$PWD/../bin
+LIBS += -lswe -lastroprocessor
+
+SOURCES += $$PWD/src/cli.cpp \
+    $$PWD/../zodiac/src/afileinfo.cpp
+
+HEADERS += $$PWD/src/cli.h \
+    $$PWD/../zodiac/src/afileinfo.h
+
+INCLUDEPATH += $$PWD/src/ \
+        $$PWD/../astroprocessor/include/ \
+        $$PWD/../zodiac/src/ \
+        $$PWD/../swe $$PWD/../../boost_1_74_0
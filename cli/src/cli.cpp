@@ -0,0 +1,67 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QThread>
+#include <QDir>
+#include <QTextStream>
+#include <QDebug>
+#include <Astroprocessor/Calc>
+
+#include "cli.h"
+
+namespace {
+
+void
+emptyOutput(QtMsgType, const QMessageLogContext&, const QString&)
+{ }
+
+} // anonymous-namespace
+
+void
+addToolOptions(QCommandLineParser& parser)
+{
+    QCommandLineOption dataOpt("data-dir", "Directory holding the swe/ "
+                               "and astroprocessor/ data (default the "
+                               "current directory).", "dir");
+    QCommandLineOption verboseOpt({"v", "verbose"}, "Keep debug output.");
+    parser.addOptions({ dataOpt, verboseOpt });
+}
+
+bool
+setUpTool(const QCommandLineParser& parser)
+{
+    if (!parser.isSet("verbose")) qInstallMessageHandler(emptyOutput);
+
+    if (parser.isSet("data-dir")
+            && !QDir::setCurrent(parser.value("data-dir")))
+    {
+        toolFail("can't use data directory " + parser.value("data-dir"));
+        return false;
+    }
+    A::load("en");
+    return true;
+}
+
+int
+toolFail(const QString& msg)
+{
+    QTextStream err(stderr);
+    err << QCoreApplication::applicationName() << ": " << msg << "\n";
+    return 1;
+}
+
+void
+runFinder(A::AspectFinder& af)
+{
+    QThread thread;
+    thread.setObjectName("omnibus finder");
+    af.moveToThread(&thread);
+
+    QEventLoop loop;
+    QObject::connect(&thread, &QThread::started,
+                     &af, &A::AspectFinder::findStuff);
+    QObject::connect(&thread, &QThread::finished, &loop, &QEventLoop::quit);
+    thread.start();
+    loop.exec();
+    thread.wait();
+}
@@ -0,0 +1,32 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <QString>
+
+class QCommandLineParser;
+
+namespace A {
+class AspectFinder;
+}
+
+// Shared by zodiac-events and zodiac-bench: where the data is, how much
+// to say, and running a finder to the end.
+
+/// Add --data-dir and --verbose to the parser.
+void addToolOptions(QCommandLineParser& parser);
+
+/// Act on the options addToolOptions() added and load the data. Paths
+/// the user gave relative to where the tool was run must be made
+/// absolute first, since --data-dir changes the current directory.
+/// False, having said why, if there's no using the data directory.
+bool setUpTool(const QCommandLineParser& parser);
+
+/// Say what went wrong on standard error, under the application's name.
+/// Returns 1, for main() to return.
+int toolFail(const QString& msg);
+
+/// Run the finder on its own thread, as the Transits view does, and
+/// wait here for it to finish.
+void runFinder(A::AspectFinder& af);
+
+#endif // CLI_H
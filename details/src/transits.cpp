@@ -629,13 +629,8 @@ public:
         beginResetModel();
 #if 1
         _evs.clear();
-        for (auto lievs: _evls) {
-            A::modalize<eventListIndex> cev(evp::curr(), lievs.first);
-            QMutexLocker ml(const_cast<QMutex*>(&(lievs.second->mutex)));
-            for (auto& ev: *lievs.second) {
-                if (ev.dateTime().isValid()) _evs.emplace_back(ev);
-            }
-        }
+        _scans.clear();
+        for (auto lievs: _evls) scanEvents(lievs.first, _evs);
 #endif
         std::sort(_evs.begin(), _evs.end(), less);
         endResetModel();
@@ -643,6 +638,38 @@ public:
         delete _chs; _chs = nullptr;
     }
 
+    /// Pick up events completed since the last scan and insert them in
+    /// sort order, rather than resetting the whole model.
+    void mergeNewEvents()
+    {
+        if (_sortPending) return;
+
+        std::vector<evp> batch;
+        for (auto lievs: _evls) scanEvents(lievs.first, batch);
+        if (batch.empty()) return;
+
+        typedef const A::HarmonicEvent* HEv;
+        std::function<bool(HEv, HEv)> less =
+                hevLess(_sortBy, _sortOrder==Qt::DescendingOrder);
+        std::sort(batch.begin(), batch.end(), less);
+
+        auto from = _evs.begin();
+        for (size_t k = 0, n = batch.size(); k < n; ) {
+            auto pos = std::upper_bound(from, _evs.end(), batch[k], less);
+            // everything else in the batch that lands at the same spot
+            size_t e = k + 1;
+            while (e < n && (pos == _evs.end() || less(batch[e], *pos))) {
+                ++e;
+            }
+            int row = int(std::distance(_evs.begin(), pos));
+            beginInsertRows(QModelIndex(), row, row + int(e - k) - 1);
+            pos = _evs.insert(pos, batch.begin() + k, batch.begin() + e);
+            endInsertRows();
+            from = pos + (e - k);
+            k = e;
+        }
+    }
+
     void addEvents(const A::HarmonicEvents& evs)
     {
         auto li = currentEvents()++;
@@ -663,6 +690,7 @@ public:
         for (auto lievit = _evls.begin(); lievit != _evls.end(); ++lievit) {
             if (evs != lievit->second) continue;
 
+            _scans.erase(lievit->first);
             _evls.erase(lievit++);
             AChangeSignalFrame chs(this);
 
@@ -681,6 +709,7 @@ public:
         if (!_changeRef) emit aboutToChange();
         beginResetModel();
         _evls.clear();
+        _scans.clear();
         _evs.clear();
         endResetModel();
     }
@@ -761,6 +790,30 @@ private:
     std::vector<evp> _evs;
     std::map<eventListIndex, const A::HarmonicEvents*> _evls;
 
+    /// how far into each event list we've looked; the finder only
+    /// publishes finished events, so there's nothing to come back for
+    struct eventScan {
+        size_t scanned = 0;
+        A::HarmonicEvents::const_iterator last;
+    };
+    std::map<eventListIndex, eventScan> _scans;
+
+    void scanEvents(eventListIndex li, std::vector<evp>& into)
+    {
+        auto evs = getEvents(li);
+        if (!evs) return;
+
+        A::modalize<eventListIndex> cev(evp::curr(), li);
+        QMutexLocker ml(&evs->mutex);
+        auto& scan = _scans[li];
+        auto it = scan.scanned ? std::next(scan.last) : evs->cbegin();
+        for ( ; it != evs->cend(); ++it) {
+            if (it->dateTime().isValid()) into.emplace_back(&*it);
+            scan.last = it;
+            ++scan.scanned;
+        }
+    }
+
     A::HarmonicEvents* getEvents(eventListIndex li) const
     {
         auto evlit = _evls.find(li);
@@ -1195,7 +1248,7 @@ void
 Transits::onProgress(double prog)
 {
     //if (_chs) saveScrollPos();
-    _evm->sort();
+    _evm->mergeNewEvents();
     if (_chs) restoreScrollPos();
 }
 
@@ -1203,7 +1256,7 @@ void
 Transits::onCompleted()
 {
 #if 1
-    _evm->sort();
+    _evm->mergeNewEvents();
 #else
     const A::Horoscope& scope(file()->horoscope());
     const auto& ida(transitsOnly()? file()->horoscope().inputData
@@ -0,0 +1,10 @@
+#-------------------------------------------------
+#
+# Headless event search over chart files
+#
+#-------------------------------------------------
+
+TARGET = zodiac-events
+TEMPLATE = app
+DESTDIR = $$_PRO_FILE_PWD_/../bin
+include(events.pri)
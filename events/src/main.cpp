@@ -0,0 +1,344 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <Astroprocessor/Calc>
+#include <Astroprocessor/Gui>
+#include <Astroprocessor/Trace>
+#include "cli.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Headless driver for the omnibus event search: one or more .dat charts
+// in, one CSV or JSONL record per event out. Charts given a common
+// --location are searched together against one shared set of transits;
+// otherwise each chart is searched in turn.
+
+namespace {
+
+bool
+parseHarmonics(const QString& spec, A::uintSSet& hs)
+{
+    for (const auto& part : spec.split(',', Qt::SkipEmptyParts)) {
+        auto ends = part.split('-');
+        bool ok1 = false, ok2 = true;
+        unsigned lo = ends.first().trimmed().toUInt(&ok1);
+        unsigned hi = ends.size() > 1? ends.last().trimmed().toUInt(&ok2)
+                                     : lo;
+        if (!ok1 || !ok2 || lo == 0 || hi < lo || ends.size() > 2) {
+            return false;
+        }
+        for (unsigned h = lo; h <= hi; ++h) hs.insert(h);
+    }
+    return !hs.empty();
+}
+
+QString
+planetName(const A::ChartPlanetId& cpid)
+{
+    static const char* s_suffixes[] = { "n", "t" };
+    if (cpid.fileId() >= 0 && cpid.fileId() < 2) {
+        return cpid.name() + "-" + s_suffixes[cpid.fileId()];
+    }
+    return cpid.name();
+}
+
+QString
+planetNames(const A::PlanetSet& ps)
+{
+    QStringList sl;
+    for (const auto& cpid : ps) sl << planetName(cpid);
+    return sl.join("=");
+}
+
+QString
+dtString(const QDateTime& dt)
+{ return dt.isValid()? dt.toUTC().toString(Qt::ISODateWithMs) : QString(); }
+
+QString
+csvField(const QString& str)
+{
+    static const QRegularExpression s_special("[\",\n]");
+    if (!str.contains(s_special)) return str;
+    QString ret(str);
+    ret.replace("\"", "\"\"");
+    return "\"" + ret + "\"";
+}
+
+class EventWriter {
+public:
+    EventWriter(QTextStream& out, bool json) : _out(out), _json(json) { }
+
+    void header()
+    {
+        if (_json) return;
+        _out << "chart,date,type,harmonic,planets,orb,rangeStart,rangeEnd\n";
+    }
+
+    void write(const QString& chart, const A::HarmonicEvent& ev)
+    {
+        auto type = A::EventTypeManager::eventTypeToBrief(ev.eventType());
+        if (_json) {
+            QJsonObject obj;
+            obj.insert("chart", chart);
+            obj.insert("date", dtString(ev.dateTime()));
+            obj.insert("type", type);
+            obj.insert("harmonic", int(ev.harmonic()));
+            QJsonArray pa;
+            for (const auto& cpid : ev.planets()) pa << planetName(cpid);
+            obj.insert("planets", pa);
+            obj.insert("orb", ev.orb());
+            if (ev.range().first.isValid()) {
+                obj.insert("rangeStart", dtString(ev.range().first));
+                obj.insert("rangeEnd", dtString(ev.range().second));
+            }
+            _out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << "\n";
+        } else {
+            _out << csvField(chart) << ','
+                 << dtString(ev.dateTime()) << ','
+                 << csvField(type) << ','
+                 << ev.harmonic() << ','
+                 << csvField(planetNames(ev.planets())) << ','
+                 << ev.orb() << ','
+                 << dtString(ev.range().first) << ','
+                 << dtString(ev.range().second) << '\n';
+        }
+        _out.flush();
+    }
+
+private:
+    QTextStream& _out;
+    bool _json;
+};
+
+} // anonymous-namespace
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("zodiac-events");
+    a.setApplicationVersion("v0.8.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Search charts for transit events "
+                                     "and write them as CSV or JSONL.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("charts", "Chart files (.dat) to search.",
+                                 "charts...");
+    QCommandLineOption fromOpt("from", "First day of the search "
+                               "(default today).", "yyyy-mm-dd");
+    QCommandLineOption toOpt("to", "Last day of the search "
+                             "(default from the search options).",
+                             "yyyy-mm-dd");
+    QCommandLineOption hsOpt({"H", "harmonics"}, "Harmonics to search, "
+                             "e.g. 1-12,16 (default the saved selection).",
+                             "list");
+    QCommandLineOption fmtOpt({"f", "format"}, "csv (default) or jsonl.",
+                              "format", "csv");
+    QCommandLineOption outOpt({"o", "output"}, "Write here instead of "
+                              "standard output.", "file");
+    QCommandLineOption optsOpt("options", "Read Events/... search options "
+                               "from this settings file.", "ini");
+    QCommandLineOption locOpt("location", "Transit location as \"lon lat "
+                              "[alt]\" (default the chart's).", "location");
+    QCommandLineOption traceOpt("trace", "Write the search's trace records "
+                                "to standard error when it's done.");
+    parser.addOptions({ fromOpt, toOpt, hsOpt, fmtOpt, outOpt, optsOpt,
+                        locOpt, traceOpt });
+    addToolOptions(parser);
+    parser.process(a);
+
+    QStringList charts;
+    for (const auto& path : parser.positionalArguments()) {
+        charts << QFileInfo(path).absoluteFilePath();   // before --data-dir
+    }
+    if (charts.isEmpty()) return toolFail("no charts given");
+
+    if (!setUpTool(parser)) return 1;
+
+    auto& opts = A::EventOptions::current();
+    if (parser.isSet(optsOpt)) {
+        QSettings ini(parser.value(optsOpt), QSettings::IniFormat);
+        if (ini.status() != QSettings::NoError) {
+            return toolFail("can't read " + parser.value(optsOpt));
+        }
+        QVariantMap map = opts.toMap();
+        for (const auto& key : ini.allKeys()) map.insert(key, ini.value(key));
+        opts = A::EventOptions(map);
+    }
+
+    QDate from = QDate::currentDate();
+    if (parser.isSet(fromOpt)) {
+        from = QDate::fromString(parser.value(fromOpt), Qt::ISODate);
+        if (!from.isValid()) return toolFail("bad --from date");
+    }
+    auto span = opts.defaultTimespan;
+    QDate to = span.addTo(from);
+    if (parser.isSet(toOpt)) {
+        to = QDate::fromString(parser.value(toOpt), Qt::ISODate);
+        if (!to.isValid() || to < from) return toolFail("bad --to date");
+    }
+
+    A::uintSSet hs;
+    if (parser.isSet(hsOpt)) {
+        if (!parseHarmonics(parser.value(hsOpt), hs)) {
+            return toolFail("bad harmonics list " + parser.value(hsOpt));
+        }
+    } else {
+        hs = A::dynAspState();
+    }
+
+    QVector3D location;
+    bool haveLocation = parser.isSet(locOpt);
+    if (haveLocation) {
+        auto v = parser.value(locOpt).split(' ', Qt::SkipEmptyParts);
+        bool okx = false, oky = false;
+        if (v.size() >= 2) {
+            location = QVector3D(v.at(0).toFloat(&okx), v.at(1).toFloat(&oky),
+                                 v.size() > 2? v.at(2).toFloat() : 0);
+        }
+        if (!okx || !oky) return toolFail("bad --location");
+    }
+
+    QString fmt = parser.value(fmtOpt).toLower();
+    if (fmt != "csv" && fmt != "jsonl") return toolFail("bad format " + fmt);
+
+    QFile outFile;
+    if (parser.isSet(outOpt)) {
+        outFile.setFileName(parser.value(outOpt));
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return toolFail("can't write " + outFile.fileName());
+        }
+    } else {
+        outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&outFile);
+#if (QT_VERSION < QT_VERSION_CHECK(6,0,0))
+    out.setCodec("UTF-8");
+#endif
+
+    EventWriter writer(out, fmt == "jsonl");
+    writer.header();
+
+    int failures = 0;
+    std::vector<std::unique_ptr<AstroFile>> natals;
+    QStringList names;
+    for (const auto& path : charts) {
+        QFileInfo qfi(path);
+        if (!qfi.exists()) {
+            toolFail("no such chart " + path);
+            ++failures;
+            continue;
+        }
+
+        AFileInfo fi;
+        fi.setFile(qfi.absoluteDir(), qfi.fileName());
+
+        std::unique_ptr<AstroFile> natal(new AstroFile);
+        natal->load(fi);
+        auto type = natal->getType();
+        if (type != TypeMale && type != TypeFemale && type != TypeEvent) {
+            toolFail(path + " isn't a natal or event chart");
+            ++failures;
+            continue;
+        }
+        natals.emplace_back(std::move(natal));
+        names << fi.baseName();
+    }
+
+    auto transitsFor = [&](const AstroFile& natal, AstroFile& trans) {
+        trans.suspendUpdate();
+        trans.setGMT(QDateTime(from, QTime(0, 0), Qt::UTC));
+        trans.setLocation(haveLocation? location : natal.getLocation());
+        trans.setZodiac(natal.getZodiac());
+        trans.setHouseSystem(natal.getHouseSystem());
+        trans.resumeUpdate();
+    };
+
+    // A search publishes its events in the order its date chunks and
+    // solver threads finish them, not by date, and fills in the pair
+    // ranges only at its very end. So a chart's records are final, and
+    // can be put in date order, as soon as its own search is over; that
+    // is when they're written, with no waiting on the other charts.
+    auto writeSorted = [&](const QString& chart, A::HarmonicEvents& evs) {
+        QMutexLocker ml(&evs.mutex);
+        std::vector<const A::HarmonicEvent*> sorted;
+        for (const auto& ev : evs) {
+            if (ev.dateTime().isValid()) sorted.push_back(&ev);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const A::HarmonicEvent* a,
+                            const A::HarmonicEvent* b)
+        { return a->dateTime() < b->dateTime(); });
+        for (auto ev : sorted) writer.write(chart, *ev);
+    };
+
+    // With a common transit location, the charts sharing the first one's
+    // zodiac are searched together against one set of transits; anything
+    // else gets a search of its own.
+    std::vector<bool> shared(natals.size(), false);
+    AstroFileList batch;
+    QStringList batchNames;
+    if (haveLocation && natals.size() > 1) {
+        auto zod = natals.front()->getZodiac();
+        for (size_t i = 0; i < natals.size(); ++i) {
+            if (natals[i]->getZodiac() != zod) continue;
+            shared[i] = true;
+            batch << natals[i].get();
+            batchNames << names.at(int(i));
+        }
+        if (batch.size() < 2) {
+            shared.assign(natals.size(), false);
+            batch.clear();
+            batchNames.clear();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        AstroFile trans;
+        transitsFor(*batch.first(), trans);
+
+        A::HarmonicEvents evs;
+        A::MultiChartFinder af(evs, { from, to }, hs, batch, &trans);
+        QObject::connect(&af, &A::MultiChartFinder::chartFinished, &a,
+                         [&](int b)
+        { writeSorted(batchNames.at(b), af.eventsFor(b)); });
+        runFinder(af);
+
+        writeSorted(QString(), evs);    // transit-only events
+    }
+
+    for (size_t i = 0; i < natals.size(); ++i) {
+        if (shared[i]) continue;
+        const auto& natal = *natals[i];
+
+        AstroFile trans;
+        transitsFor(natal, trans);
+
+        A::HarmonicEvents evs;
+        A::OmnibusFinder af(evs, { from, to }, hs,
+                            { natals[i].get(), &trans });
+        runFinder(af);
+
+        writeSorted(names.at(int(i)), evs);
+    }
+
+    if (parser.isSet(traceOpt)) {
+        QTextStream err(stderr);
+        for (const auto& line : A::Trace::dumpAll()) err << line << "\n";
+    }
+
+    return failures? 2 : 0;
+}
@@ -2,3 +2,4 @@ TEMPLATE = lib
 QT -= core gui
 DESTDIR = $$_PRO_FILE_PWD_/../bin
 include(swe.pri)
+unix:LIBS += -lpthread
@@ -65,6 +65,8 @@
 #if MSDOS
 #include <tchar.h>
 #include <windows.h>
+#else
+#include <pthread.h>
 #endif
 #include "swejpl.h"
 #include "swephexp.h"
@@ -1288,7 +1290,7 @@ void CALL_CONV swe_close(void)
     swed.deps = NULL;
   }
   if (swed.n_fixstars_records > 0) {
-    free(swed.fixed_stars);
+    /* shared by all threads, see fixstar_catalog_load() */
     swed.fixed_stars = NULL;
     swed.n_fixstars_real = 0;
     swed.n_fixstars_named = 0;
@@ -6287,8 +6289,262 @@ int32 fixstar_cut_string(char *srecord, char *star, struct fixed_star *stardata,
   return OK;
 }
 
-/* function loads all fixed stars from file sefstars.txt,
- * into swed.fixed_stars, which is a pointer to an array
+/* The star file is read once for the whole process. swed is thread-local,
+ * so otherwise every thread reads the file for itself, and swe_fixstar()
+ * scans it again for every star it looks up.
+ * The data lines are kept in file order, so sequential star numbers count
+ * them as before, and are hashed by their search keys: the traditional
+ * name and the Bayer designation, formatted like the search names of
+ * fixstar_format_search_name(). A search used to take the first line in
+ * the file whose key began with the search name, and that needn't be the
+ * line with that very key ("men" found an earlier "menkalinan"), so each
+ * key also records the line the scan would have found. Designations with
+ * blanks in them (",V645 Cen") are found now; the scan compared them
+ * blanks and all and never matched. The sorted records
+ * for swe_fixstar2() are
+ * shared the same way. Nothing here changes once it is loaded, so only
+ * loading takes the lock, and swe_close() leaves it alone.
+ */
+struct fixstar_line {
+  char *record;
+  char name[SWI_STAR_LENGTH + 1];
+  char bayer[SWI_STAR_LENGTH + 1];	/* with its leading comma */
+  int32 name_first;	/* first line whose name begins with name */
+  int32 bayer_first;	/* likewise for bayer */
+};
+
+struct fixstar_key {
+  const char *key;
+  int32 line;
+};
+
+static struct {
+  AS_BOOL loaded;
+  AS_BOOL is_old_starfile;
+  struct fixstar_line *lines;
+  int32 nlines;
+  int32 *slots;		/* line number + 1, or 0 for an empty slot */
+  uint32 nslots;
+  struct fixed_star *stars;	/* for swe_fixstar2(), see load_all_fixed_stars() */
+  int32 n_real, n_named, n_records;
+} fixstar_cat;
+
+/* this thread has seen the catalog loaded, and needn't lock again */
+static TLS AS_BOOL fixstar_cat_seen = FALSE;
+
+#if MSDOS
+static SRWLOCK fixstar_lock = SRWLOCK_INIT;
+#define FIXSTAR_LOCK()		AcquireSRWLockExclusive(&fixstar_lock)
+#define FIXSTAR_UNLOCK()	ReleaseSRWLockExclusive(&fixstar_lock)
+#else
+static pthread_mutex_t fixstar_lock = PTHREAD_MUTEX_INITIALIZER;
+#define FIXSTAR_LOCK()		pthread_mutex_lock(&fixstar_lock)
+#define FIXSTAR_UNLOCK()	pthread_mutex_unlock(&fixstar_lock)
+#endif
+
+static uint32 fixstar_hash(const char *key)
+{
+  uint32 h = 2166136261u;	/* FNV-1a */
+  for (; *key != '\0'; key++)
+    h = (h ^ (unsigned char) *key) * 16777619u;
+  return h;
+}
+
+/* returns the slot of a search key: either the one holding it,
+ * or the empty one where it belongs */
+static uint32 fixstar_slot(const char *key)
+{
+  uint32 mask = fixstar_cat.nslots - 1;
+  uint32 k = fixstar_hash(key) & mask;
+  int32 i;
+  struct fixstar_line *fl;
+  while ((i = fixstar_cat.slots[k]) != 0) {
+    fl = &fixstar_cat.lines[i - 1];
+    if (strcmp(fl->name, key) == 0 || strcmp(fl->bayer, key) == 0)
+      break;
+    k = (k + 1) & mask;
+  }
+  return k;
+}
+
+/* index of the first data line with this search key, or -1 */
+static int32 fixstar_catalog_find(const char *key)
+{
+  if (*key == '\0')
+    return -1;
+  return fixstar_cat.slots[fixstar_slot(key)] - 1;
+}
+
+/* search keys of a data line; empty if the line has no comma */
+static void fixstar_line_keys(const char *s, struct fixstar_line *fl)
+{
+  const char *sp = strchr(s, ',');
+  char *dp;
+  int n;
+  *fl->name = *fl->bayer = '\0';
+  if (sp == NULL)
+    return;
+  // traditional name without white space, in lower case
+  for (dp = fl->name, n = 0; s < sp && n < SWI_STAR_LENGTH; s++) {
+    if (*s == ' ') continue;
+    *dp++ = tolower((int) *s);
+    n++;
+  }
+  *dp = '\0';
+  // comma and Bayer designation without white space
+  *fl->bayer = ',';
+  for (dp = fl->bayer + 1, n = 1, s = sp + 1;
+       *s != '\0' && *s != ',' && *s != '\n' && *s != '\r' && n < SWI_STAR_LENGTH; s++) {
+    if (*s == ' ') continue;
+    *dp++ = *s;
+    n++;
+  }
+  *dp = '\0';
+}
+
+static int fixstar_key_cmp(const void *a, const void *b)
+{
+  const struct fixstar_key *ka = (const struct fixstar_key *) a;
+  const struct fixstar_key *kb = (const struct fixstar_key *) b;
+  int c = strcmp(ka->key, kb->key);
+  if (c != 0)
+    return c;
+  return (ka->line > kb->line) - (ka->line < kb->line);
+}
+
+/* fills in name_first or bayer_first: sorted, the keys that begin with
+ * a key follow it in a run, so the first line is the least in the run */
+static int32 fixstar_prefix_firsts(AS_BOOL bayer)
+{
+  struct fixstar_key *keys;
+  struct fixstar_line *fl;
+  const char *key;
+  int32 i, j, n = 0, first;
+  size_t len;
+  keys = (struct fixstar_key *) malloc((fixstar_cat.nlines + 1) * sizeof(struct fixstar_key));
+  if (keys == NULL)
+    return ERR;
+  for (i = 0; i < fixstar_cat.nlines; i++) {
+    fl = &fixstar_cat.lines[i];
+    if (bayer)
+      fl->bayer_first = i;
+    else
+      fl->name_first = i;
+    key = bayer ? fl->bayer : fl->name;
+    if (*key == '\0') continue;
+    keys[n].key = key;
+    keys[n].line = i;
+    n++;
+  }
+  qsort((void *) keys, (size_t) n, sizeof(struct fixstar_key), fixstar_key_cmp);
+  for (i = 0; i < n; i++) {
+    // only the first line with a key is ever looked up by it
+    if (i > 0 && strcmp(keys[i - 1].key, keys[i].key) == 0) continue;
+    len = strlen(keys[i].key);
+    first = keys[i].line;
+    for (j = i + 1; j < n && strncmp(keys[j].key, keys[i].key, len) == 0; j++) {
+      if (keys[j].line < first)
+	first = keys[j].line;
+    }
+    fl = &fixstar_cat.lines[keys[i].line];
+    if (bayer)
+      fl->bayer_first = first;
+    else
+      fl->name_first = first;
+  }
+  free(keys);
+  return OK;
+}
+
+static void fixstar_catalog_free(void)
+{
+  int32 i;
+  for (i = 0; i < fixstar_cat.nlines; i++)
+    free(fixstar_cat.lines[i].record);
+  free(fixstar_cat.lines);
+  free(fixstar_cat.slots);
+  fixstar_cat.lines = NULL;
+  fixstar_cat.slots = NULL;
+  fixstar_cat.nlines = 0;
+  fixstar_cat.nslots = 0;
+}
+
+/* reads the star file into fixstar_cat unless that has been done
+ * already; it is tried again after a failure, since the ephemeris
+ * path may not have been set yet. */
+static int32 fixstar_catalog_load(char *serr)
+{
+  FILE *fp;
+  char s[AS_MAXCH];
+  struct fixstar_line *fl;
+  int32 i, nalloc = 0;
+  uint32 k;
+  AS_BOOL is_old = FALSE;
+  char *serr_alloc = "error in function fixstar_catalog_load(): could not allocate fixed stars catalog";
+  if (fixstar_cat_seen) {
+    swed.is_old_starfile = fixstar_cat.is_old_starfile;
+    return OK;
+  }
+  FIXSTAR_LOCK();
+  if (!fixstar_cat.loaded) {
+    if ((fp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE, swed.ephepath, serr)) == NULL) {
+      is_old = TRUE;
+      if ((fp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE_OLD, swed.ephepath, NULL)) == NULL) {
+	FIXSTAR_UNLOCK();
+	/* no fixed star file available, error message is already in serr. */
+	return ERR;
+      }
+    }
+    while (fgets(s, AS_MAXCH, fp) != NULL) {
+      // skip comment lines
+      if (*s == '#') continue;
+      if (fixstar_cat.nlines == nalloc) {
+	nalloc = nalloc ? 2 * nalloc : 1024;
+	fl = (struct fixstar_line *) realloc(fixstar_cat.lines, nalloc * sizeof(struct fixstar_line));
+	if (fl == NULL) goto alloc_err;
+	fixstar_cat.lines = fl;
+      }
+      fl = &fixstar_cat.lines[fixstar_cat.nlines];
+      if ((fl->record = (char *) malloc(strlen(s) + 1)) == NULL) goto alloc_err;
+      strcpy(fl->record, s);
+      fixstar_line_keys(s, fl);
+      fixstar_cat.nlines++;
+    }
+    fclose(fp);
+    fp = NULL;
+    // two keys a line, at most half full
+    for (fixstar_cat.nslots = 16; fixstar_cat.nslots < 4 * (uint32) fixstar_cat.nlines; )
+      fixstar_cat.nslots *= 2;
+    fixstar_cat.slots = (int32 *) calloc(fixstar_cat.nslots, sizeof(int32));
+    if (fixstar_cat.slots == NULL) goto alloc_err;
+    for (i = 0; i < fixstar_cat.nlines; i++) {
+      fl = &fixstar_cat.lines[i];
+      // the first line with a key keeps it
+      if (*fl->name != '\0' && fixstar_cat.slots[k = fixstar_slot(fl->name)] == 0)
+	fixstar_cat.slots[k] = i + 1;
+      if (*fl->bayer != '\0' && fixstar_cat.slots[k = fixstar_slot(fl->bayer)] == 0)
+	fixstar_cat.slots[k] = i + 1;
+    }
+    if (fixstar_prefix_firsts(FALSE) != OK || fixstar_prefix_firsts(TRUE) != OK)
+      goto alloc_err;
+    fixstar_cat.is_old_starfile = is_old;
+    fixstar_cat.loaded = TRUE;
+  }
+  FIXSTAR_UNLOCK();
+  fixstar_cat_seen = TRUE;
+  swed.is_old_starfile = fixstar_cat.is_old_starfile;
+  return OK;
+  alloc_err:
+  if (fp != NULL)
+    fclose(fp);
+  fixstar_catalog_free();
+  FIXSTAR_UNLOCK();
+  if (serr != NULL) strcpy(serr, serr_alloc);
+  return ERR;
+}
+
+/* function loads all fixed stars from file sefstars.txt, by way of
+ * fixstar_cat, into swed.fixed_stars, which is a pointer to an array
  * of struct fixed_stars.
  * Every star has a record with its Bayer/Flamsteed designation 
  * as its search key.
@@ -6306,8 +6562,8 @@ int32 fixstar_cut_string(char *srecord, char *star, struct fixed_star *stardata,
 static int32 load_all_fixed_stars(char *serr) 
 {
   int32 retc = OK;
-  int nstars = 0, line = 0, fline = 0, nrecs = 0, nnamed = 0;
-  char s[AS_MAXCH], *sp;
+  int nstars = 0, line = 0, nrecs = 0, nnamed = 0;
+  char *s, *sp;
   char srecord[AS_MAXCH];
   struct fixed_star fstdata;
   char last_starbayer[SWI_STAR_LENGTH + 1];
@@ -6315,29 +6571,20 @@ static int32 load_all_fixed_stars(char *serr)
   if (swed.n_fixstars_records > 0) {
     return -2;
   }
-  if (swed.fixfp == NULL) {
-    if ((swed.fixfp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE, swed.ephepath, serr)) == NULL) {
-      swed.is_old_starfile = TRUE;
-      if ((swed.fixfp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE_OLD, swed.ephepath, NULL)) == NULL) {
-	swed.is_old_starfile = FALSE;
-	/* no fixed star file available, error message is already in serr. */
-	return ERR;
-      }
-    }
-  }
-  rewind(swed.fixfp);
+  if (fixstar_catalog_load(serr) != OK)
+    return ERR;
+  FIXSTAR_LOCK();
+  if (fixstar_cat.n_records > 0)
+    goto shared;
   swed.fixed_stars = NULL;
-  while (fgets(s, AS_MAXCH, swed.fixfp) != NULL) {
-    fline++;	
-    // skip comment lines
-    if (*s == '#') continue;
+  for (line = 0; line < fixstar_cat.nlines; line++) {
+    s = fixstar_cat.lines[line].record;
     if (*s == '\n') continue;
     if (*s == '\r') continue;
     if (*s == '\0') continue;
-    line++;
     strcpy(srecord, s);
     retc = fixstar_cut_string(srecord, NULL, &fstdata, serr);
-    if (retc == ERR) return ERR;
+    if (retc == ERR) goto return_err;
     // if star has a traditional name, save it with that name as its search key
     if (*fstdata.starname != '\0') {
       nrecs++;
@@ -6349,7 +6596,7 @@ static int32 load_all_fixed_stars(char *serr)
       // star name to lowercase and compare with search string
       for (sp = fstdata.skey; *sp != '\0'; sp++) 
 	*sp = tolower((int) *sp);
-      if ((retc = save_star_in_struct(nrecs, &fstdata, serr)) == ERR) return ERR;
+      if ((retc = save_star_in_struct(nrecs, &fstdata, serr)) == ERR) goto return_err;
     }
     // also save it with Bayer designation as search key;
     // only if it has not been saved already
@@ -6363,19 +6610,31 @@ static int32 load_all_fixed_stars(char *serr)
     while ((sp = strchr(fstdata.skey, ' ')) != NULL)
       swi_strcpy(sp, sp+1);
     strcpy(last_starbayer, fstdata.starbayer);
-    if ((retc = save_star_in_struct(nrecs, &fstdata, serr)) == ERR) return ERR;
+    if ((retc = save_star_in_struct(nrecs, &fstdata, serr)) == ERR) goto return_err;
     // also save it with sequential star number as search key (NO!!!!)
     // nrecs++;
     // sprintf(fstdata.skey, "%07d", nstars);
     // if ((retc = save_star_in_struct(nrecs, &fstdata, serr)) == ERR) return ERR;
   }
-  swed.n_fixstars_real = nstars;
-  swed.n_fixstars_named = nnamed;
-  swed.n_fixstars_records = nrecs;
   //printf("nstars=%d, nrecords=%d\n", nstars, nrecs);
   (void) qsort ((void *) swed.fixed_stars, (size_t) nrecs, sizeof (struct fixed_star),
                     (int (CMP_CALL_CONV *)(const void *,const void *))(fixedstar_name_compare));
+  fixstar_cat.stars = swed.fixed_stars;
+  fixstar_cat.n_real = nstars;
+  fixstar_cat.n_named = nnamed;
+  fixstar_cat.n_records = nrecs;
+  shared:
+  swed.fixed_stars = fixstar_cat.stars;
+  swed.n_fixstars_real = fixstar_cat.n_real;
+  swed.n_fixstars_named = fixstar_cat.n_named;
+  swed.n_fixstars_records = fixstar_cat.n_records;
+  FIXSTAR_UNLOCK();
   return retc;
+  return_err:
+  free(swed.fixed_stars);
+  swed.fixed_stars = NULL;
+  FIXSTAR_UNLOCK();
+  return ERR;
 }
 
 /* function calculates a fixstar from a star data struct 
@@ -7456,17 +7715,15 @@ static int open_jpl_file(double *ss, char *fname, char *fpath, char *serr)
 #if 1
 static int32 swi_fixstar_load_record(char *star, char *srecord, char *sname, char *sbayer, double *dparams, char *serr)
 {
-  char s[AS_MAXCH + 20], *sp, *sp2;	/* 20 byte for SE_STARFILE */
+  char *sp;
   char sstar[SWI_STAR_LENGTH + 1];
-  char fstar[SWI_STAR_LENGTH + 1];
-  int i, star_nr = 0;
-  int line = 0;
-  int fline = 0;
+  int star_nr = 0;
+  int32 line = 0;
   int32 retc = OK;
   AS_BOOL  is_bayer = FALSE;
   size_t cmplen;
-  size_t slen;
   struct fixed_star stardata;
+  struct fixstar_line *fl;
   /* function formats the input search name of a star:
    * - remove white spaces
    * - traditional name to lower case (Bayer designation remains as it is)
@@ -7487,78 +7744,42 @@ static int32 swi_fixstar_load_record(char *star, char *srecord, char *sname, cha
   }
   cmplen = strlen(sstar);
   /******************************************************
-   * Star file
+   * Star file, read once into fixstar_cat
    * close to the beginning, a few stars selected by Astrodienst.
    * These can be accessed by giving their number instead of a name.
    * All other stars can be accessed by name.
    * Comment lines start with # and are ignored.
    ******************************************************/
-  if (swed.fixfp == NULL) {
-    if ((swed.fixfp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE, swed.ephepath, serr)) == NULL) {
-      swed.is_old_starfile = TRUE;
-      if ((swed.fixfp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE_OLD, swed.ephepath, NULL)) == NULL) {
-	swed.is_old_starfile = FALSE;
-	/* no fixed star file available, error message is already in serr. */
-	return ERR;
-      }
-    }
-  }
-  rewind(swed.fixfp);
-  while (fgets(s, AS_MAXCH, swed.fixfp) != NULL) {
-    fline++;	
-    // skip comment lines
-    if (*s == '#') continue;
-    line++;
-    // search string is star number in sefstars.txt
-    if (star_nr == line)
+  if (fixstar_catalog_load(serr) != OK)
+    return ERR;
+  // search string is star number in sefstars.txt
+  if (star_nr > 0) {
+    line = star_nr - 1;
+    if (line < fixstar_cat.nlines)
       goto found;
-    else if (star_nr > 0)
-      continue;
-    // invalid line without comma
-    if ((sp = strchr(s, ',')) == NULL) {
-      if (serr != NULL) {
-	sprintf(serr, "star file %s damaged at line %d", SE_STARFILE, fline);
-      }
-      return ERR;
-    } 
-    // search string is Bayer or Flamsteed designation
-    if (is_bayer) {
-      if (strncmp(sp, sstar, cmplen) == 0)
+  // search string is a whole name or designation, though a line before
+  // it may have a longer one that begins with it
+  } else if ((line = fixstar_catalog_find(sstar)) >= 0) {
+    fl = &fixstar_cat.lines[line];
+    line = is_bayer ? fl->bayer_first : fl->name_first;
+    goto found;
+  // or the beginning of one: first match in the file
+  } else {
+    for (line = 0; line < fixstar_cat.nlines; line++) {
+      fl = &fixstar_cat.lines[line];
+      if (strncmp(is_bayer ? fl->bayer : fl->name, sstar, cmplen) == 0)
         goto found;
-      else
-        continue;
-    }
-    // search string is traditional name
-    *sp = '\0';	/* cut off after first field to get star name, ',' -> '\0' */
-    //strncpy(fstar, s, SWI_STAR_LENGTH);
-    slen = swi_strnlen(s, SE_MAX_STNAME);
-    memcpy(fstar, s, slen);
-    fstar[slen] = '\0';  /* force termination */
-    *sp = ',';  /* add comma again */
-    //fstar[SWI_STAR_LENGTH] = '\0';	/* force termination */
-    // remove white spaces from star name
-    while ((sp = strchr(fstar, ' ')) != NULL)
-      swi_strcpy(sp, sp+1);
-    i = (int) strlen(fstar);
-    // length of star name differs from length of search string: continue
-    if (i < (int) cmplen)
-      continue;
-    // star name to lowercase and compare with search string
-    for (sp2 = fstar; *sp2 != '\0'; sp2++) {
-      *sp2 = tolower((int) *sp2);
     }
-    if (strncmp(fstar, sstar, cmplen) == 0) 
-      goto found;
   }
   if (serr != NULL) {
     sprintf(serr, "star  not found");
     if (strlen(serr) + strlen(star) < AS_MAXCH) {
       sprintf(serr, "star %s not found", star);
     }
-    return ERR;
   }
+  return ERR;
   found:
-  strcpy(srecord, s);
+  strcpy(srecord, fixstar_cat.lines[line].record);
   retc = fixstar_cut_string(srecord, star, &stardata, serr);
   if (retc == ERR) return ERR;
   if (dparams != NULL) {
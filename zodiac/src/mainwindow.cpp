@@ -205,6 +205,7 @@ AstroWidget::setupFile(AstroFile* file, bool suspendUpdate)
     if (!file) return;
     bool hasChanges = file->hasUnsavedChanges();
     file->suspendUpdate();
+    file->setCalculateInBackground();   // keep scrubbing off the GUI thread
 
     if (file->getGMT() == QDateTime::fromSecsSinceEpoch(0))  // set current date, time, timezone
     {
@@ -795,6 +796,8 @@ AstroWidget::currentSettings()
 void
 AstroWidget::applySettings(const AppSettings& s)
 {
+    A::HoroscopeCache::clear();     // orbs and such may have changed
+
     geoWdg->setLocation(vectorFromString(s.value("Scope/defaultLocation").toString()));
     geoWdg->setLocationName(s.value("Scope/defaultLocationName").toString());
 